@@ -33,6 +33,7 @@
 
 //Bank State header
 
+#include <vector>
 #include "bob_buspacket.h"
 
 namespace BOBSim
@@ -54,10 +55,11 @@ public:
     uint64_t nextActivate;
     uint64_t nextRead;
     uint64_t nextWrite;
+    uint64_t nextPrecharge; //only used by the open page policies
 //	  uint64_t nextStrobeMin;
 //	  uint64_t nextStrobeMax;
 //	  uint64_t nextRefresh;     // ToDo!
-    unsigned stateChangeCountdown;
+    uint64_t stateChangeCycle; //0: none pending
     BusPacketType lastCommand;
 
 	//Functions
@@ -67,38 +69,82 @@ public:
       nextActivate(0),
       nextRead(0),
       nextWrite(0),
+      nextPrecharge(0),
 //      nextStrobeMin(0),
 //      nextStrobeMax(0),
 //      nextRefresh(0),
-      stateChangeCountdown(0),
+      stateChangeCycle(0),
       lastCommand(REFRESH) // ToDo
     {}
 
-    void UpdateStateChange(void)
+    //called at stateChangeCycle, returns the delay of the following state change (0: none)
+    unsigned UpdateStateChange(void)
     {
-      if(this->stateChangeCountdown && !--this->stateChangeCountdown)
+      this->stateChangeCycle = 0;
+      switch(lastCommand)
       {
-        switch(lastCommand)
-        {
-        case REFRESH:
-          this->currentBankState = IDLE;
-          break;
-        case WRITE_P:
-        case READ_P:
-          this->currentBankState = PRECHARGING;
-          this->stateChangeCountdown = tRP;
-          this->lastCommand = PRECHARGE;
-          break;
-        case PRECHARGE:
-          this->currentBankState = IDLE;
-          break;
-        default:
-          ERROR("== WTF STATE? : "<<this->lastCommand);
-          exit(0);
-        }
+      case REFRESH:
+        this->currentBankState = IDLE;
+        return 0;
+      case WRITE_P:
+      case READ_P:
+        this->currentBankState = PRECHARGING;
+        this->lastCommand = PRECHARGE;
+        return tRP;
+      case PRECHARGE:
+        this->currentBankState = IDLE;
+        return 0;
+      default:
+        ERROR("== WTF STATE? : "<<this->lastCommand);
+        exit(0);
       }
     }
 };
+
+//Number of cycles a timer wheel covers in one turn, longer delays take more turns
+#define TIMER_WHEEL_SLOTS 256
+
+//Bank state changes sorted by their cycle, so that only due banks get touched each tick
+class TimerWheel
+{
+private:
+    std::vector<unsigned> slots[TIMER_WHEEL_SLOTS];
+
+public:
+    void Schedule(uint64_t cycle, unsigned id)
+    {
+      slots[cycle & (TIMER_WHEEL_SLOTS - 1)].push_back(id);
+    }
+
+    //the state of bank (id) changes delay cycles after cycle, replaces a pending change
+    void ScheduleStateChange(uint64_t cycle, unsigned delay, unsigned id, BankState *bank)
+    {
+      bank->stateChangeCycle = cycle + delay;
+      Schedule(bank->stateChangeCycle, id);
+    }
+
+    //hands out the ids of the slot of cycle, each one goes to Fire()
+    void Expire(uint64_t cycle, std::vector<unsigned> *ids)
+    {
+      ids->clear();
+      ids->swap(slots[cycle & (TIMER_WHEEL_SLOTS - 1)]);
+    }
+
+    //changes the state of the bank, if it is due; returns false for replaced changes and later turns
+    bool Fire(uint64_t cycle, unsigned id, BankState *bank)
+    {
+      if (bank->stateChangeCycle != cycle) {
+        if (bank->stateChangeCycle > cycle && !((bank->stateChangeCycle - cycle) & (TIMER_WHEEL_SLOTS - 1)))
+          Schedule(bank->stateChangeCycle, id);
+        return false;
+      }
+
+      unsigned delay = bank->UpdateStateChange();
+      if (delay)
+        ScheduleStateChange(cycle, delay, id, bank);
+      return true;
+    }
+};
 }
 
 #endif
@@ -0,0 +1,120 @@
+#ifndef COMMANDSCHEDULER_H
+#define COMMANDSCHEDULER_H
+
+//Command scheduler header
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+#include "bob_globals.h"
+
+using namespace std;
+
+namespace BOBSim
+{
+class BusPacket;
+
+//A transaction, which still waits for its ACTIVATE
+struct PendingTransaction
+{
+    int64_t order; //arrival order, logic priority requests go negative
+    BusPacket *activate;
+    BusPacket *column;
+
+    PendingTransaction(int64_t order, BusPacket *activate, BusPacket *column) :
+      order(order),
+      activate(activate),
+      column(column)
+    {}
+};
+
+//A column command, whose row is open
+struct QueuedColumn
+{
+    int64_t order;
+    BusPacket *column;
+
+    QueuedColumn(int64_t order, BusPacket *column) :
+      order(order),
+      column(column)
+    {}
+};
+
+//Work queue of a single bank
+struct BankQueue
+{
+    deque<QueuedColumn> columns;         //ordered by arrival
+    deque<PendingTransaction> pending;   //ordered by arrival
+
+    bool empty(void) const
+    {
+      return columns.empty() && pending.empty();
+    }
+
+    //the row of the transaction got opened
+    void AddColumn(const PendingTransaction &trans)
+    {
+      deque<QueuedColumn>::iterator it = columns.end();
+      while (it != columns.begin() && (*(it - 1)).order > trans.order)
+        --it;
+      columns.insert(it, QueuedColumn(trans.order, trans.column));
+    }
+};
+
+//What a bank is able to issue in the current cycle
+struct BankCandidate
+{
+    unsigned bank;   //rank * NUM_BANKS + bank
+    bool column;     //column command to an open row, else ACTIVATE or PRECHARGE
+    bool precharge;  //closes the open row for the next pending ACTIVATE
+    unsigned index;  //into BankQueue::columns
+    int64_t order;
+
+    BankCandidate(void) :
+      bank(0),
+      column(false),
+      precharge(false),
+      index(0),
+      order(0)
+    {}
+};
+
+//Picks the command which issues next, out of the candidates of all banks which are able to issue
+class CommandScheduler
+{
+public:
+    virtual ~CommandScheduler(void) {}
+    //returns an index into candidates, which is not empty
+    virtual unsigned Select(const vector<BankCandidate> &candidates) = 0;
+
+    static CommandScheduler* Create(unsigned policy, unsigned banks);
+};
+
+//Oldest issuable command first, as a single queue would do it
+class FCFSScheduler : public CommandScheduler
+{
+public:
+    unsigned Select(const vector<BankCandidate> &candidates);
+};
+
+//Oldest issuable column command (row hit) first, then the oldest ACTIVATE/PRECHARGE
+class FRFCFSScheduler : public CommandScheduler
+{
+public:
+    unsigned Select(const vector<BankCandidate> &candidates);
+};
+
+//Each bank queue gets its turn, in order within a bank
+class BankRoundRobinScheduler : public CommandScheduler
+{
+private:
+    unsigned banks;
+    unsigned last;
+
+public:
+    BankRoundRobinScheduler(unsigned banks) : banks(banks), last(banks - 1) {}
+    unsigned Select(const vector<BankCandidate> &candidates);
+};
+}
+
+#endif
@@ -175,6 +175,30 @@ enum AddressMappingScheme
 //Heuristic used for adding new requests to the available ports
 #define PORT_HEURISTIC               FIRST_AVAILABLE
 
+//Row buffer management of the simple controller
+enum RowBufferPolicy
+{
+	CLOSE_PAGE,   //every access closes its row (READ_P/WRITE_P)
+	OPEN_PAGE,    //rows stay open till a conflict or a refresh closes them
+	ADAPTIVE_PAGE //rows stay open if a hit is queued or predicted, idle ones time out
+};
+#ifndef ROW_BUFFER_POLICY
+#define ROW_BUFFER_POLICY            CLOSE_PAGE
+#endif
+//Number of DRAM cycles an idle open row is kept with ADAPTIVE_PAGE
+#define ROW_IDLE_TIMEOUT             64
+
+//Command scheduling of the simple controller, its work queue is kept per bank
+enum CommandSchedulingPolicy
+{
+	FCFS,            //oldest issuable command first
+	FR_FCFS,         //row hits first, then the oldest
+	BANK_ROUND_ROBIN //banks take turns, in order within a bank
+};
+#ifndef COMMAND_SCHEDULER
+#define COMMAND_SCHEDULER            FCFS
+#endif
+
 //Number of requests each simple controller can hold in its work queue
 #define CHANNEL_WORK_Q_MAX           16 //entries
 //Amount of response data that can be held in each simple controller return queue
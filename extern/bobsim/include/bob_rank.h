@@ -47,12 +47,18 @@ private:
     //Fields
     //Rank ID in relation to the channel
     unsigned id;
-    //Amount of time until data is returned from the DRAM & Storage for response data
-    vector< pair<unsigned, BusPacket*> > readReturn; /* Countdown & Queue */
+    //Cycle at which data is returned from the DRAM & Storage for response data
+    vector< pair<uint64_t, BusPacket*> > readReturn; /* Cycle & Queue */
     //Callback for returning data
     DRAMChannel *dramchannel;
     //State of all banks in the DRAM channel
     BankState *bankStates;
+    //Pending bank state changes
+    TimerWheel stateChanges;
+    vector<unsigned> expired;
+    //Constraints common to all banks of the rank (tCCD, tRRD)
+    uint64_t nextColumn;
+    uint64_t nextActivate;
     uint64_t currentClockCycle;
 public:
     //Functions
@@ -33,8 +33,11 @@
 
 //Simple Controller header
 
+#include <algorithm>
 #include <deque>
 #include "bob_globals.h"
+#include "bob_bankstate.h"
+#include "bob_commandscheduler.h"
 
 using namespace std;
 
@@ -44,11 +47,89 @@ class Transaction;
 class BusPacket;
 class DRAMChannel;
 class BankState;
+
+//Row buffer bookkeeping of a bank, next to its BankState
+struct RowBufferState
+{
+    bool conflict;           //the open row got closed for a queued ACTIVATE
+    unsigned predictor;      //2 bit saturating counter, >= 2: next access to the bank likely hits
+    unsigned lastRow;        //row of the last access, rates a miss for the predictor
+    uint64_t lastAccess;
+
+    //Statistics
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t conflicts;
+
+    RowBufferState(void) :
+      conflict(false),
+      predictor(2),
+      lastRow(~0u),
+      lastAccess(0),
+      hits(0),
+      misses(0),
+      conflicts(0)
+    {}
+};
+
+//Timing constraints common to all banks of a rank
+struct RankTiming
+{
+    uint64_t nextRead;
+    uint64_t nextWrite;
+    uint64_t nextActivate;
+
+    RankTiming(void) :
+      nextRead(0),
+      nextWrite(0),
+      nextActivate(0)
+    {}
+};
+
+//Latest of a timing constraint, which holds for all ranks but the one it came from
+struct OtherRankTiming
+{
+    uint64_t first;     //latest overall
+    unsigned firstRank;
+    uint64_t second;    //latest of any other rank than firstRank
+
+    OtherRankTiming(void) :
+      first(0),
+      firstRank(~0u),
+      second(0)
+    {}
+
+    void Update(unsigned rank, uint64_t cycle)
+    {
+      if (rank == firstRank)
+        first = max(first, cycle);
+      else if (cycle > first) {
+        second = first;
+        first = cycle;
+        firstRank = rank;
+      }
+      else
+        second = max(second, cycle);
+    }
+    uint64_t Get(unsigned rank) const
+    {
+      return (rank != firstRank) ? first : second;
+    }
+};
+
 class SimpleController
 {
 private:
     //Functions
     bool IsIssuable(BusPacket *busPacket);
+    bool IsRowOpen(BankState *bankState);
+    void SetBankState(unsigned rank, unsigned bank, CurrentBankState state);
+    bool FindCandidate(unsigned rank, unsigned bank, BankCandidate *candidate);
+    void TakeRowHits(unsigned rank, unsigned bank);
+    bool KeepRowOpen(BusPacket *busPacket);
+    void IssuePrecharge(unsigned rank, unsigned bank);
+    bool CloseIdleRow(unsigned rank, uint64_t idle);
+    void RowAccess(unsigned rank, unsigned bank, unsigned row, bool hit);
 #ifndef HMCSIM_SUPPORT
     void AddressMapping(uint64_t physicalAddress, unsigned *rank, unsigned *bank, unsigned *row, unsigned *col);
 #endif
@@ -72,15 +153,27 @@ private:
 
     //Bank states for all banks in this channel
     vector< vector<BankState> > bankStates;
+    vector< vector<RowBufferState> > rowBuffers;
+    //Number of banks per rank in each CurrentBankState
+    vector< vector<unsigned> > bankStateCounts;
+    //Pending bank state changes, by rank * NUM_BANKS + bank
+    TimerWheel stateChanges;
+    vector<unsigned> expired;
+
+    //Earliest READ/WRITE/ACTIVATE per rank, on top of the ones of each bank
+    vector<RankTiming> rankTimings;
+    OtherRankTiming otherRankRead;
+    OtherRankTiming otherRankWrite;
 
     //Storage and counters to determine write bursts
-    vector< pair<unsigned, BusPacket*> > writeBurst; /* Countdown & Queue */
+    vector< pair<uint64_t, BusPacket*> > writeBurst; /* Cycle & Queue */
 
-    //Sliding window for each rank to determine tFAW adherence
-    vector< vector<unsigned> > tFAWWindow;
+    //Sliding window for each rank to determine tFAW adherence, as the cycles its entries expire
+    vector< deque<uint64_t> > tFAWWindow;
 
-    //Refresh counters
-    vector<unsigned> refreshCounters;
+    //Cycles at which the ranks need a refresh, and the earliest of them
+    vector<uint64_t> refreshCycles;
+    uint64_t nextRefresh;
 
     //More bookkeeping
 #ifndef BOBSIM_NO_LOG
@@ -88,8 +181,15 @@ private:
     unsigned writeCounter;
 #endif
 
-    //Work queue for pending requests (DRAM specific commands go here)
-    deque<BusPacket*> commandQueue;
+    //Work queue for pending requests (DRAM specific commands go here), one per bank
+    vector< vector<BankQueue> > bankQueues;
+    vector<unsigned> queuedBanks; //rank * NUM_BANKS + bank of the non-empty ones
+    int64_t nextOrder;
+    int64_t nextPriorityOrder;
+
+    //Picks the bank to issue from
+    CommandScheduler *scheduler;
+    vector<BankCandidate> candidates;
 
     //Power fields
 #ifndef BOBSIM_NO_LOG_ENERGY
@@ -106,6 +206,7 @@ public:
     ~SimpleController(void);
     void Update(void); // this is called each tCK
     void AddTransaction(Transaction *trans);
+    const RowBufferState& GetRowBufferState(unsigned rank, unsigned bank) { return rowBuffers[rank][bank]; }
 
 #ifndef BOBSIM_NO_LOG
     void _update(void); // this is called each clk
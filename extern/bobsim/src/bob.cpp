@@ -766,6 +766,22 @@ void BOB::PrintStats(ofstream &statsOut, ofstream &powerOut, bool finalPrint, un
   readCounter = 0;
   writeCounter = 0;
 
+#if ROW_BUFFER_POLICY != CLOSE_PAGE
+  PRINT(" == Row Buffer (hits / misses / conflicts)");
+  for (unsigned i = 0; i < NUM_CHANNELS; i++) {
+    uint64_t hits = 0, misses = 0, conflicts = 0;
+    for (unsigned r = 0; r < this->num_ranks; r++) {
+      for (unsigned b = 0; b < NUM_BANKS; b++) {
+        const RowBufferState &rowbuf = channels[i]->simpleController.GetRowBufferState(r, b);
+        hits += rowbuf.hits;
+        misses += rowbuf.misses;
+        conflicts += rowbuf.conflicts;
+      }
+    }
+    PRINT("  -- " << i << "] " << hits << " / " << misses << " / " << conflicts);
+  }
+#endif
+
   //
   //
   //POWER
@@ -852,6 +868,7 @@ void BOB::ReportCallback(BusPacket *bp)
     }
     break;
   case WRITE_P:
+  case WRITE:
     bobwrapper->WriteIssuedCallback(bp->port, bp->address);
     break;
   case WRITE_DATA:
@@ -0,0 +1,57 @@
+//Command scheduler source
+
+#include "../include/bob_commandscheduler.h"
+
+using namespace std;
+using namespace BOBSim;
+
+CommandScheduler* CommandScheduler::Create(unsigned policy, unsigned banks)
+{
+  switch (policy) {
+  case FR_FCFS:
+    return new FRFCFSScheduler();
+  case BANK_ROUND_ROBIN:
+    return new BankRoundRobinScheduler(banks);
+  case FCFS:
+  default:
+    return new FCFSScheduler();
+  }
+}
+
+unsigned FCFSScheduler::Select(const vector<BankCandidate> &candidates)
+{
+  unsigned selected = 0;
+  for (unsigned i = 1; i < candidates.size(); i++) {
+    if (candidates[i].order < candidates[selected].order)
+      selected = i;
+  }
+  return selected;
+}
+
+unsigned FRFCFSScheduler::Select(const vector<BankCandidate> &candidates)
+{
+  unsigned selected = 0;
+  for (unsigned i = 1; i < candidates.size(); i++) {
+    //a row hit beats any row command, otherwise the older one goes
+    if ((candidates[i].column && !candidates[selected].column) ||
+        (candidates[i].column == candidates[selected].column && candidates[i].order < candidates[selected].order))
+      selected = i;
+  }
+  return selected;
+}
+
+unsigned BankRoundRobinScheduler::Select(const vector<BankCandidate> &candidates)
+{
+  //the first bank after the last one served
+  unsigned selected = 0;
+  unsigned distance = banks;
+  for (unsigned i = 0; i < candidates.size(); i++) {
+    unsigned d = (candidates[i].bank + banks - last - 1) % banks;
+    if (d < distance) {
+      distance = d;
+      selected = i;
+    }
+  }
+  last = candidates[selected].bank;
+  return selected;
+}
@@ -179,6 +179,7 @@ void DRAMChannel::ReceiveOnCmdBus(BusPacket *busPacket)
   switch (busPacket->busPacketType) {
   case ACTIVATE:
   case WRITE_P:   //Report the WRITE is finally going
+  case WRITE:
     bob->ReportCallback(busPacket);
     break;
   default:
@@ -40,6 +40,8 @@ Rank::Rank(unsigned rankid, DRAMChannel *_channel) :
   id(rankid),
   dramchannel(_channel),
   bankStates(new BankState[NUM_BANKS]),
+  nextColumn(0),
+  nextActivate(0),
   currentClockCycle(0)
 {
 }
@@ -47,25 +49,24 @@ Rank::Rank(unsigned rankid, DRAMChannel *_channel) :
 Rank::~Rank(void)
 {
   delete[] bankStates;
-  for (vector< pair<unsigned, BusPacket*> >::iterator it = this->readReturn.begin(); it != this->readReturn.end(); ++it) {
+  for (vector< pair<uint64_t, BusPacket*> >::iterator it = this->readReturn.begin(); it != this->readReturn.end(); ++it) {
     delete (*it).second;
   }
 }
 
 void Rank::Update(void)
 {
-  for (unsigned i = 0; i < NUM_BANKS; i++) {
-    bankStates[i].UpdateStateChange();
+  //the bus delivers before the rank updates, so commands received in this cycle already count it
+  uint64_t cycle = currentClockCycle + 1;
+
+  stateChanges.Expire(cycle, &expired);
+  for (unsigned i = 0; i < expired.size(); i++) {
+    stateChanges.Fire(cycle, expired[i], &bankStates[expired[i]]);
   }
 
-  if (readReturn.size()) {
-    for (unsigned i = 0; i < readReturn.size(); i++) {
-      readReturn[i].first--;
-    }
-    if ((*readReturn.begin()).first == 0) {
-      dramchannel->ReceiveOnDataBus((*readReturn.begin()).second, true);
-      readReturn.erase(readReturn.begin());
-    }
+  if (readReturn.size() && (*readReturn.begin()).first == cycle) {
+    dramchannel->ReceiveOnDataBus((*readReturn.begin()).second, true);
+    readReturn.erase(readReturn.begin());
   }
 
   //increment clock cycle
@@ -78,7 +79,7 @@ void Rank::ReceiveFromBus(BusPacket *busPacket)
   case REFRESH:
     for (unsigned i = 0; i < NUM_BANKS; i++) {
       if (bankStates[i].currentBankState != IDLE ||
-          bankStates[i].nextActivate > currentClockCycle) {
+          max(bankStates[i].nextActivate, nextActivate) > currentClockCycle) {
         ERROR("== Error - Refresh when not allowed in bank " << i);
         ERROR("           NextAct : " << bankStates[i].nextActivate);
         ERROR("           State : " << bankStates[i].currentBankState);
@@ -87,14 +88,14 @@ void Rank::ReceiveFromBus(BusPacket *busPacket)
 
       bankStates[i].lastCommand = REFRESH;
       bankStates[i].currentBankState = REFRESHING;
-      bankStates[i].stateChangeCountdown = tRFC;
+      stateChanges.ScheduleStateChange(currentClockCycle, tRFC, i, &bankStates[i]);
       bankStates[i].nextActivate = currentClockCycle + tRFC;
     }
     delete busPacket;
     break;
   case ACTIVATE:
     if (bankStates[busPacket->bank].currentBankState != IDLE ||
-        currentClockCycle < bankStates[busPacket->bank].nextActivate) {
+        currentClockCycle < max(bankStates[busPacket->bank].nextActivate, nextActivate)) {
       ERROR("== Error - Rank receiving ACT when not allowed");
       exit(0);
     }
@@ -108,18 +109,16 @@ void Rank::ReceiveFromBus(BusPacket *busPacket)
     bankStates[busPacket->bank].nextWrite = currentClockCycle + tRCD;
     bankStates[busPacket->bank].nextActivate = currentClockCycle + tRC;
 
-    for (unsigned i = 0; i < NUM_BANKS; i++) {
-      if (i != busPacket->bank) {
-        bankStates[i].nextActivate = max(bankStates[i].nextActivate, currentClockCycle + tRRD);
-      }
-    }
+    nextActivate = max(nextActivate, currentClockCycle + tRRD);
 
     delete busPacket;
     break;
   case READ_P:
+  case READ:
+  {
     if (bankStates[busPacket->bank].currentBankState != ROW_ACTIVE ||
         bankStates[busPacket->bank].openRowAddress != busPacket->row ||
-        currentClockCycle < bankStates[busPacket->bank].nextRead) {
+        currentClockCycle < max(bankStates[busPacket->bank].nextRead, nextColumn)) {
       ERROR("== Error - Rank receiving READ_P when not allowed");
       ERROR("           Current Clock Cycle : " << currentClockCycle);
       exit(0);
@@ -128,25 +127,30 @@ void Rank::ReceiveFromBus(BusPacket *busPacket)
     //
     //update bankstates
     //
+    bool autoPrecharge = (busPacket->busPacketType == READ_P);
     busPacket->busPacketType = READ_DATA;
-    readReturn.push_back(make_pair(tCL, busPacket));
+    readReturn.push_back(make_pair(currentClockCycle + tCL, busPacket));
 
-    for (unsigned i = 0; i < NUM_BANKS; i++) {
-      bankStates[i].nextRead = max(bankStates[i].nextRead, currentClockCycle + tCCD);
-      bankStates[i].nextWrite = max(bankStates[i].nextWrite, currentClockCycle + tCCD);
-    }
+    nextColumn = max(nextColumn, currentClockCycle + tCCD);
 
+    //row stays open
+    if (!autoPrecharge) {
+      bankStates[busPacket->bank].lastCommand = READ;
+      break;
+    }
     bankStates[busPacket->bank].lastCommand = READ_P;
-    bankStates[busPacket->bank].stateChangeCountdown = tRTP;
+    stateChanges.ScheduleStateChange(currentClockCycle, tRTP, busPacket->bank, &bankStates[busPacket->bank]);
     bankStates[busPacket->bank].nextActivate = currentClockCycle + tRTP + tRP;
     bankStates[busPacket->bank].nextRead = bankStates[busPacket->bank].nextActivate;
     bankStates[busPacket->bank].nextWrite = bankStates[busPacket->bank].nextActivate;
     break;
+  }
   case WRITE_P:
+  case WRITE:
   {
     if (bankStates[busPacket->bank].currentBankState != ROW_ACTIVE ||
         bankStates[busPacket->bank].openRowAddress != busPacket->row ||
-        currentClockCycle < bankStates[busPacket->bank].nextWrite) {
+        currentClockCycle < max(bankStates[busPacket->bank].nextWrite, nextColumn)) {
       ERROR("== Error - Rank " << id << " receiving WRITE_P when not allowed");
       ERROR("           currentClockCycle : " << currentClockCycle);
       exit(0);
@@ -155,13 +159,17 @@ void Rank::ReceiveFromBus(BusPacket *busPacket)
     //
     //update bank states
     //
-    for (unsigned i = 0; i < NUM_BANKS; i++) {
-      bankStates[i].nextRead = max(bankStates[i].nextRead, currentClockCycle + tCCD);
-      bankStates[i].nextWrite = max(bankStates[i].nextWrite, currentClockCycle + tCCD);
+    nextColumn = max(nextColumn, currentClockCycle + tCCD);
+
+    //row stays open
+    if (busPacket->busPacketType == WRITE) {
+      bankStates[busPacket->bank].lastCommand = WRITE;
+      delete busPacket;
+      break;
     }
     bankStates[busPacket->bank].lastCommand = WRITE_P;
     unsigned burstLength = busPacket->reqBurstSize();     // incoming!
-    bankStates[busPacket->bank].stateChangeCountdown = tCWL + burstLength + tWR;
+    stateChanges.ScheduleStateChange(currentClockCycle, tCWL + burstLength + tWR, busPacket->bank, &bankStates[busPacket->bank]);
     bankStates[busPacket->bank].nextActivate = currentClockCycle + tCWL + burstLength + tWR + tRP;
     bankStates[busPacket->bank].nextRead = bankStates[busPacket->bank].nextActivate;
     bankStates[busPacket->bank].nextWrite = bankStates[busPacket->bank].nextActivate;
@@ -177,8 +185,25 @@ void Rank::ReceiveFromBus(BusPacket *busPacket)
       exit(0);
     }
 
-    bankStates[busPacket->bank].stateChangeCountdown = tWR;
-    bankStates[busPacket->bank].nextActivate = currentClockCycle + tWR + tRP;
+    //auto-precharge follows the write recovery
+    if (bankStates[busPacket->bank].lastCommand == WRITE_P) {
+      stateChanges.ScheduleStateChange(currentClockCycle, tWR, busPacket->bank, &bankStates[busPacket->bank]);
+      bankStates[busPacket->bank].nextActivate = currentClockCycle + tWR + tRP;
+    }
+
+    delete busPacket;
+    break;
+  case PRECHARGE:
+    if (bankStates[busPacket->bank].currentBankState != ROW_ACTIVE) {
+      ERROR("== Error - Rank receiving PRECHARGE when not allowed");
+      ERROR("           Current Clock Cycle : " << currentClockCycle);
+      exit(0);
+    }
+
+    bankStates[busPacket->bank].currentBankState = PRECHARGING;
+    bankStates[busPacket->bank].lastCommand = PRECHARGE;
+    stateChanges.ScheduleStateChange(currentClockCycle, tRP, busPacket->bank, &bankStates[busPacket->bank]);
+    bankStates[busPacket->bank].nextActivate = max(bankStates[busPacket->bank].nextActivate, currentClockCycle + tRP);
 
     delete busPacket;
     break;
@@ -60,12 +60,20 @@ SimpleController::SimpleController(DRAMChannel *parent, unsigned ranks, unsigned
   currentClockCycle(0),
 
   bankStates(ranks, vector<BankState>(NUM_BANKS, BankState())),
-  tFAWWindow(ranks, vector<unsigned>(0)),
+  rowBuffers(ranks, vector<RowBufferState>(NUM_BANKS, RowBufferState())),
+  bankStateCounts(ranks, vector<unsigned>(REFRESHING + 1, 0)),
+  rankTimings(ranks, RankTiming()),
+  tFAWWindow(ranks, deque<uint64_t>()),
+  nextRefresh(0),
 
 #ifndef BOBSIM_NO_LOG
   readCounter(0),
   writeCounter(0),
 #endif
+  bankQueues(ranks, vector<BankQueue>(NUM_BANKS, BankQueue())),
+  nextOrder(0),
+  nextPriorityOrder(-1),
+  scheduler(CommandScheduler::Create(COMMAND_SCHEDULER, ranks * NUM_BANKS)),
   //init power fields
 #ifndef BOBSIM_NO_LOG_ENERGY
   backgroundEnergyOpenCtr(ranks, 0),
@@ -89,17 +97,30 @@ SimpleController::SimpleController(DRAMChannel *parent, unsigned ranks, unsigned
 {
   //Make the bank state objects
   for (unsigned i = 0; i < ranks; i++) {
-    //init refresh counters
-    refreshCounters.push_back(((7800 / tCK) / ranks) * (i + 1));
+    bankStateCounts[i][IDLE] = NUM_BANKS;
+
+    //init refresh counters, they are due as soon as they count down to zero
+    refreshCycles.push_back((unsigned)(((7800 / tCK) / ranks) * (i + 1)) - 1);
   }
+  nextRefresh = *min_element(refreshCycles.begin(), refreshCycles.end());
 }
 
 SimpleController::~SimpleController(void)
 {
-  for (deque<BusPacket*>::iterator it = commandQueue.begin(); it != commandQueue.end(); ++it) {
-    delete *it;
+  for (unsigned r = 0; r < this->ranks; r++) {
+    for (unsigned b = 0; b < NUM_BANKS; b++) {
+      BankQueue *queue = &bankQueues[r][b];
+      for (deque<QueuedColumn>::iterator it = queue->columns.begin(); it != queue->columns.end(); ++it) {
+        delete (*it).column;
+      }
+      for (deque<PendingTransaction>::iterator it = queue->pending.begin(); it != queue->pending.end(); ++it) {
+        delete (*it).activate;
+        delete (*it).column;
+      }
+    }
   }
-  for (vector< pair<unsigned, BusPacket*> >::iterator it = writeBurst.begin(); it != writeBurst.end(); ++it) {
+  delete scheduler;
+  for (vector< pair<uint64_t, BusPacket*> >::iterator it = writeBurst.begin(); it != writeBurst.end(); ++it) {
     delete (*it).second;
   }
 }
@@ -107,8 +128,11 @@ SimpleController::~SimpleController(void)
 #ifndef BOBSIM_NO_LOG
 void SimpleController::_update(void)
 {
-  for (unsigned j = 0; j < this->commandQueue.size(); j++) {
-    this->commandQueue[j]->queueWaitTime += (this->commandQueue[j]->busPacketType == ACTIVATE);
+  for (unsigned i = 0; i < this->queuedBanks.size(); i++) {
+    deque<PendingTransaction> &pending = this->bankQueues[queuedBanks[i] / NUM_BANKS][queuedBanks[i] % NUM_BANKS].pending;
+    for (unsigned j = 0; j < pending.size(); j++) {
+      pending[j].activate->queueWaitTime++;
+    }
   }
 }
 #endif
@@ -122,8 +146,8 @@ void SimpleController::Update(void)
 #ifndef BOBSIM_NO_LOG
   unsigned currentCount = 0;
   //count all the ACTIVATES waiting in the queue
-  for (unsigned i = 0; i < commandQueue.size(); i++) {
-    currentCount += (commandQueue[i]->busPacketType == ACTIVATE);
+  for (unsigned i = 0; i < queuedBanks.size(); i++) {
+    currentCount += bankQueues[queuedBanks[i] / NUM_BANKS][queuedBanks[i] % NUM_BANKS].pending.size();
   }
   if (currentCount > commandQueueMax) commandQueueMax = currentCount;
 
@@ -131,82 +155,46 @@ void SimpleController::Update(void)
   commandQueueAverage += currentCount;
 #endif
 
-  for (unsigned r = 0; r < this->ranks; r++) {
 #if !defined(BOBSIM_NO_LOG) || !defined(BOBSIM_NO_LOG_ENERGY)
-    bool bankOpen = false;
-#endif
-    for (unsigned b = 0; b < NUM_BANKS; b++) {
-#if !defined(BOBSIM_NO_LOG) || !defined(BOBSIM_NO_LOG_ENERGY)
-      switch (bankStates[r][b].currentBankState) {
-      //count the number of idle banks
-      case IDLE:
-#ifndef BOBSIM_NO_LOG
-        numIdleBanksAverage++;
-#endif
-        break;
-
-      //count the number of active banks
-      case ROW_ACTIVE:
-#ifndef BOBSIM_NO_LOG
-        numActBanksAverage++;
-#endif
-#ifndef BOBSIM_NO_LOG_ENERGY
-        bankOpen = true;
-#endif
-        break;
-
-      //count the number of precharging banks
-      case PRECHARGING:
-#ifndef BOBSIM_NO_LOG
-        numPreBanksAverage++;
-#endif
-        break;
-
-      //count the number of refreshing banks
-      case REFRESHING:
+  for (unsigned r = 0; r < this->ranks; r++) {
+    vector<unsigned> &count = bankStateCounts[r];
 #ifndef BOBSIM_NO_LOG
-        numRefBanksAverage++;
-#endif
-#ifndef BOBSIM_NO_LOG_ENERGY
-        bankOpen = true;
-#endif
-        break;
-      }
+    numIdleBanksAverage += count[IDLE];
+    numActBanksAverage += count[ROW_ACTIVE];
+    numPreBanksAverage += count[PRECHARGING];
+    numRefBanksAverage += count[REFRESHING];
 #endif
 
-      //Updates the bank states for each rank
-      bankStates[r][b].UpdateStateChange();
-    }
-
     //
     //Power
     //
     //DRAM_BUS_WIDTH/2 because value accounts for DDR
 #ifndef BOBSIM_NO_LOG_ENERGY
-    if (bankOpen)
+    if (count[ROW_ACTIVE] || count[REFRESHING])
       backgroundEnergyOpenCtr[r]++;
     else
       backgroundEnergyCloseCtr[r]++;
 #endif
+  }
+#endif
 
-    //
-    //Update
-    //
-    //Updates the sliding window for tFAW
-    for (unsigned i = 0; i < tFAWWindow[r].size(); i++) {
-      if (!--tFAWWindow[r][i])
-        tFAWWindow[r].erase(tFAWWindow[r].begin());
+  //
+  //Update
+  //
+  //Updates the bank states, which are due
+  stateChanges.Expire(currentClockCycle, &expired);
+  for (unsigned i = 0; i < expired.size(); i++) {
+    unsigned rank = expired[i] / NUM_BANKS;
+    BankState *bankstate = &bankStates[rank][expired[i] % NUM_BANKS];
+    CurrentBankState state = bankstate->currentBankState;
+    if (stateChanges.Fire(currentClockCycle, expired[i], bankstate)) {
+      bankStateCounts[rank][state]--;
+      bankStateCounts[rank][bankstate->currentBankState]++;
     }
-
-    //Handle refresh counters
-    refreshCounters[r] -= (refreshCounters[r] > 0);
   }
 
 //Send write data to data bus
-  for (unsigned i = 0; i < writeBurst.size(); i++) {
-    writeBurst[i].first--;
-  }
-  if (writeBurst.size() && (*writeBurst.begin()).first == 0) {
+  if (writeBurst.size() && (*writeBurst.begin()).first == currentClockCycle) {
     if (DEBUG_CHANNEL) DEBUG("     == Sending Write Data : ");
     channel->ReceiveOnDataBus((*writeBurst.begin()).second, false);
     writeBurst.erase(writeBurst.begin());
@@ -215,13 +203,13 @@ void SimpleController::Update(void)
   bool issuingRefresh = false;
 
 //Figure out if everyone who needs a refresh can actually receive one
-  for (unsigned r = 0; r < this->ranks; r++) {
-    if (!refreshCounters[r]) {
+  for (unsigned r = 0; r < this->ranks && currentClockCycle >= nextRefresh; r++) {
+    if (currentClockCycle >= refreshCycles[r]) {
       if (DEBUG_CHANNEL) DEBUG("      !! -- Rank " << r << " needs refresh");
       //Check to be sure we can issue a refresh
       bool canIssueRefresh = true;
       for (unsigned b = 0; b < NUM_BANKS; b++) {
-        if (bankStates[r][b].nextActivate > currentClockCycle ||
+        if (max(bankStates[r][b].nextActivate, rankTimings[r].nextActivate) > currentClockCycle ||
             bankStates[r][b].currentBankState != IDLE) {
           canIssueRefresh = false;
           break;
@@ -246,162 +234,191 @@ void SimpleController::Update(void)
 #endif
 
         for (unsigned b = 0; b < NUM_BANKS; b++) {
-          bankStates[r][b].currentBankState = REFRESHING;
-          bankStates[r][b].stateChangeCountdown = tRFC;
+          SetBankState(r, b, REFRESHING);
+          stateChanges.ScheduleStateChange(currentClockCycle, tRFC, r * NUM_BANKS + b, &bankStates[r][b]);
           bankStates[r][b].nextActivate = currentClockCycle + tRFC;
           bankStates[r][b].lastCommand = REFRESH;
         }
 
         //reset refresh counters
-        for (unsigned i = 0; i < this->ranks; i++) {
-          if (!refreshCounters[r]) {
-            refreshCounters[r] = 7800 / tCK;
-          }
-        }
+        refreshCycles[r] = currentClockCycle + (unsigned)(7800 / tCK);
+        nextRefresh = *min_element(refreshCycles.begin(), refreshCycles.end());
 
         //only issue one
         break;
       }
+      //open rows have to be closed first
+      else if (ROW_BUFFER_POLICY != CLOSE_PAGE && CloseIdleRow(r, 0)) {
+        issuingRefresh = true;
+        break;
+      }
     }
   }
 
 //If no refresh is being issued then do this block
   if (!issuingRefresh) {
-    for (unsigned i = 0; i < commandQueue.size(); i++) {
-      //make sure we don't send a command ahead of its own ACTIVATE
-      BusPacket *buspkt = commandQueue[i];
-      if ((!(i
-             && buspkt->transactionID == commandQueue[i - 1]->transactionID))
-          && IsIssuable(buspkt)) {     //Checks to see if this particular request can be issued
-        //send to channel
-        this->channel->ReceiveOnCmdBus(buspkt);
-
-        //update channel controllers bank state bookkeeping
-        unsigned rank = buspkt->rank;
-        unsigned bank = buspkt->bank;
-
-        //
-        //Main block for determining what to do with each type of command
-        //
-        BankState *bankstate = &bankStates[rank][bank];
-        unsigned burstLength = buspkt->reqBurstSize();
-        switch (buspkt->busPacketType) {
-        case READ_P:
-          outstandingReads++;
-          waitingACTS--;
-          if (waitingACTS < 0) {
-            ERROR("#@)($J@)#(RJ");
-            exit(0);
-          }
-
-          //keep track of energy
+    //only banks with queued commands are asked
+    candidates.clear();
+    for (unsigned i = 0; i < queuedBanks.size(); i++) {
+      BankCandidate candidate;
+      if (FindCandidate(queuedBanks[i] / NUM_BANKS, queuedBanks[i] % NUM_BANKS, &candidate))
+        candidates.push_back(candidate);
+    }
+    BankCandidate *candidate = candidates.empty() ? NULL : &candidates[scheduler->Select(candidates)];
+
+    //the open row has to be closed first (conflict)
+    if (candidate && candidate->precharge) {
+      rowBuffers[candidate->bank / NUM_BANKS][candidate->bank % NUM_BANKS].conflict = true;
+      IssuePrecharge(candidate->bank / NUM_BANKS, candidate->bank % NUM_BANKS);
+    }
+    else if (candidate) {
+      BankQueue *queue = &bankQueues[candidate->bank / NUM_BANKS][candidate->bank % NUM_BANKS];
+      BusPacket *buspkt;
+      if (candidate->column) {
+        buspkt = queue->columns[candidate->index].column;
+        queue->columns.erase(queue->columns.begin() + candidate->index);
+        if (queue->empty())
+          queuedBanks.erase(find(queuedBanks.begin(), queuedBanks.end(), candidate->bank));
+        if (ROW_BUFFER_POLICY != CLOSE_PAGE && KeepRowOpen(buspkt))
+          buspkt->busPacketType = (buspkt->busPacketType == READ_P) ? READ : WRITE;
+      }
+      else {
+        //its column command may go as soon as the row is open
+        buspkt = queue->pending.front().activate;
+        queue->AddColumn(queue->pending.front());
+        queue->pending.pop_front();
+      }
+
+      //send to channel
+      this->channel->ReceiveOnCmdBus(buspkt);
+
+      //update channel controllers bank state bookkeeping
+      unsigned rank = buspkt->rank;
+      unsigned bank = buspkt->bank;
+
+      //
+      //Main block for determining what to do with each type of command
+      //
+      BankState *bankstate = &bankStates[rank][bank];
+      //a read occupies the data bus with its response
+      unsigned burstLength = (buspkt->busPacketType == READ_P || buspkt->busPacketType == READ) ?
+                             buspkt->respBurstSize() : buspkt->reqBurstSize();
+      switch (buspkt->busPacketType) {
+      case READ_P:
+      case READ:
+        outstandingReads++;
+        waitingACTS--;
+        if (waitingACTS < 0) {
+          ERROR("#@)($J@)#(RJ");
+          exit(0);
+        }
+
+        //keep track of energy
 #ifndef BOBSIM_NO_LOG_ENERGY
-          burstEnergyCtr[rank]++;
+        burstEnergyCtr[rank]++;
 #endif
 
-          bankstate->lastCommand = buspkt->busPacketType;
-          bankstate->stateChangeCountdown = (4 * tCK > 7.5) ? tRTP : ceil(7.5 / tCK); //4 clk or 7.5ns
+        bankstate->lastCommand = buspkt->busPacketType;
+        if (buspkt->busPacketType == READ_P) {
+          stateChanges.ScheduleStateChange(currentClockCycle, (4 * tCK > 7.5) ? tRTP : ceil(7.5 / tCK), candidate->bank, bankstate); //4 clk or 7.5ns
           bankstate->nextActivate = max(bankstate->nextActivate, currentClockCycle + tRTP + tRP);
 //					bankstate->nextRefresh = currentClockCycle + tRTP + tRP;
-
-          for (unsigned r = 0; r < this->ranks; r++) {
-            uint64_t read_offset;
-            if (r == rank)
-              read_offset = max((uint)tCCD, burstLength);
-            else
-              read_offset = burstLength + tRTRS;
-
-            for (unsigned b = 0; b < NUM_BANKS; b++) {
-              bankStates[r][b].nextRead = max(bankStates[r][b].nextRead,
-                                              currentClockCycle + read_offset);
-              bankStates[r][b].nextWrite = max(bankStates[r][b].nextWrite,
-                                               currentClockCycle + (tCL + burstLength + tRTRS - tCWL));
-            }
-          }
-
-          //prevents read or write being issued while waiting for auto-precharge to close page
+        }
+        else
+          bankstate->nextPrecharge = max(bankstate->nextPrecharge, currentClockCycle + tRTP);
+
+        //data bus turnaround, for the other ranks with the rank to rank switch
+        rankTimings[rank].nextRead = max(rankTimings[rank].nextRead,
+                                         currentClockCycle + max((uint)tCCD, burstLength));
+        otherRankRead.Update(rank, currentClockCycle + burstLength + tRTRS);
+        rankTimings[rank].nextWrite = max(rankTimings[rank].nextWrite,
+                                          currentClockCycle + (tCL + burstLength + tRTRS - tCWL));
+        otherRankWrite.Update(rank, currentClockCycle + (tCL + burstLength + tRTRS - tCWL));
+
+        //prevents read or write being issued while waiting for auto-precharge to close page
+        if (buspkt->busPacketType == READ_P) {
           bankstate->nextRead = bankstate->nextActivate;
           bankstate->nextWrite = bankstate->nextActivate;
-          break;
-        case WRITE_P:
-        {
-          waitingACTS--;
-          if (waitingACTS < 0) {
-            ERROR(")(JWE)(FJEWF");
-            exit(0);
-          }
-
-          //keep track of energy
+        }
+        rowBuffers[rank][bank].lastAccess = currentClockCycle;
+        break;
+      case WRITE_P:
+      case WRITE:
+      {
+        waitingACTS--;
+        if (waitingACTS < 0) {
+          ERROR(")(JWE)(FJEWF");
+          exit(0);
+        }
+
+        //keep track of energy
 #ifndef BOBSIM_NO_LOG_ENERGY
-          burstEnergyCtr[rank] += (IDD4W - IDD3N) * BL / 2 * ((DRAM_BUS_WIDTH / 2 * 8) / this->deviceWidth);
+        burstEnergyCtr[rank] += (IDD4W - IDD3N) * BL / 2 * ((DRAM_BUS_WIDTH / 2 * 8) / this->deviceWidth);
 #endif
 
-          BusPacket *writeData = new BusPacket(*buspkt);
-          writeData->busPacketType = WRITE_DATA;
-          writeBurst.push_back(make_pair(tCWL, writeData));
-          if (DEBUG_CHANNEL) DEBUG("     !!! After Issuing WRITE_P, burstQueue is :" << writeBurst.size() << " " << writeBurst.size() << " with head : " << (*writeBurst.begin()).second);
+        BusPacket *writeData = new BusPacket(*buspkt);
+        writeData->busPacketType = WRITE_DATA;
+        writeBurst.push_back(make_pair(currentClockCycle + tCWL, writeData));
+        if (DEBUG_CHANNEL) DEBUG("     !!! After Issuing WRITE_P, burstQueue is :" << writeBurst.size() << " " << writeBurst.size() << " with head : " << (*writeBurst.begin()).second);
 
-          bankstate->lastCommand = buspkt->busPacketType;
-          unsigned stateChangeCountdown = tCWL + burstLength + tWR;
-          bankstate->stateChangeCountdown = stateChangeCountdown;
-          bankstate->nextActivate = currentClockCycle + stateChangeCountdown + tRP;
+        bankstate->lastCommand = buspkt->busPacketType;
+        unsigned writeRecovery = tCWL + burstLength + tWR;
+        if (buspkt->busPacketType == WRITE_P) {
+          stateChanges.ScheduleStateChange(currentClockCycle, writeRecovery, candidate->bank, bankstate);
+          bankstate->nextActivate = currentClockCycle + writeRecovery + tRP;
 //			bankstate->nextRefresh = bankstate->nextActivate;
-
-          for (unsigned r = 0; r < this->ranks; r++) {
-            if (r == rank) {
-              for (unsigned b = 0; b < NUM_BANKS; b++) {
-                bankStates[r][b].nextRead = max(bankStates[r][b].nextRead,
-                                                currentClockCycle + burstLength + tCWL + tWTR);
-                bankStates[r][b].nextWrite = max(bankStates[r][b].nextWrite,
-                                                 currentClockCycle + (uint64_t)max((uint)tCCD, burstLength));
-              }
-            }
-            else {
-              for (unsigned b = 0; b < NUM_BANKS; b++) {
-                bankStates[r][b].nextRead = max(bankStates[r][b].nextRead,
-                                                currentClockCycle + burstLength + tRTRS + tCWL - tCL);
-                bankStates[r][b].nextWrite = max(bankStates[r][b].nextWrite,
-                                                 currentClockCycle + burstLength + tRTRS);
-              }
-            }
-          }
-
-          //prevents read or write being issued while waiting for auto-precharge to close page
+        }
+        else
+          bankstate->nextPrecharge = max(bankstate->nextPrecharge, currentClockCycle + writeRecovery);
+
+        rankTimings[rank].nextRead = max(rankTimings[rank].nextRead,
+                                         currentClockCycle + burstLength + tCWL + tWTR);
+        rankTimings[rank].nextWrite = max(rankTimings[rank].nextWrite,
+                                          currentClockCycle + (uint64_t)max((uint)tCCD, burstLength));
+        otherRankRead.Update(rank, currentClockCycle + burstLength + tRTRS + tCWL - tCL);
+        otherRankWrite.Update(rank, currentClockCycle + burstLength + tRTRS);
+
+        //prevents read or write being issued while waiting for auto-precharge to close page
+        if (buspkt->busPacketType == WRITE_P) {
           bankstate->nextRead = bankstate->nextActivate;
           bankstate->nextWrite = bankstate->nextActivate;
-          break;
         }
-        case ACTIVATE:
-          for (unsigned b = 0; b < NUM_BANKS; b++) {
-            if (b != bank) {
-              bankStates[rank][b].nextActivate = max(currentClockCycle + tRRD, bankStates[rank][b].nextActivate);
-            }
-          }
+        rowBuffers[rank][bank].lastAccess = currentClockCycle;
+        break;
+      }
+      case ACTIVATE:
+        //tRC of the bank itself covers tRRD
+        rankTimings[rank].nextActivate = max(currentClockCycle + tRRD, rankTimings[rank].nextActivate);
 
 #ifndef BOBSIM_NO_LOG_ENERGY
-          actpreEnergyCtr[rank]++;
+        actpreEnergyCtr[rank]++;
 #endif
 
-          bankstate->lastCommand = buspkt->busPacketType;
-          bankstate->currentBankState = ROW_ACTIVE;
-          bankstate->openRowAddress = buspkt->row;
-          bankstate->nextActivate = currentClockCycle + tRC;
-          bankstate->nextRead = max(currentClockCycle + tRCD, bankstate->nextRead);
-          bankstate->nextWrite = max(currentClockCycle + tRCD, bankstate->nextWrite);
-
-          //keep track of sliding window
-          tFAWWindow[rank].push_back(tFAW);
+        bankstate->lastCommand = buspkt->busPacketType;
+        SetBankState(rank, bank, ROW_ACTIVE);
+        bankstate->openRowAddress = buspkt->row;
+        bankstate->nextActivate = currentClockCycle + tRC;
+        bankstate->nextRead = max(currentClockCycle + tRCD, bankstate->nextRead);
+        bankstate->nextWrite = max(currentClockCycle + tRCD, bankstate->nextWrite);
+        bankstate->nextPrecharge = currentClockCycle + tRAS;
+        RowAccess(rank, bank, buspkt->row, false);
 
-          break;
-        default:
-          ERROR("Unexpected packet type");
-          abort();
-        }
-
-        //erase
-        commandQueue.erase(commandQueue.begin() + i);
+        //keep track of sliding window, IsIssuable() dropped the expired entries
+        //an entry lasts a cycle longer, if the one in front of it is still open (like the countdown used to)
+        tFAWWindow[rank].push_back(currentClockCycle + tFAW + !tFAWWindow[rank].empty());
 
         break;
+      default:
+        ERROR("Unexpected packet type");
+        abort();
+      }
+    }
+
+    //command bus is idle, close a row nobody asked for lately
+    if (ROW_BUFFER_POLICY == ADAPTIVE_PAGE && !candidate) {
+      for (unsigned r = 0; r < this->ranks; r++) {
+        if (CloseIdleRow(r, ROW_IDLE_TIMEOUT))
+          break;
       }
     }
   }
@@ -428,9 +445,12 @@ bool SimpleController::IsIssuable(BusPacket *busPacket)
   unsigned burstLength = busPacket->reqBurstSize();
   switch (busPacket->busPacketType) {
   case READ_P:
+  case READ:
     if (bankState->currentBankState == ROW_ACTIVE &&
         bankState->openRowAddress == busPacket->row &&
         currentClockCycle >= bankState->nextRead &&
+        currentClockCycle >= rankTimings[rank].nextRead &&
+        currentClockCycle >= otherRankRead.Get(rank) &&
         (channel->readReturnQueue.size() + outstandingReads) * (burstLength * DRAM_BUS_WIDTH) < CHANNEL_RETURN_Q_MAX) {
       return true;
     }
@@ -443,9 +463,12 @@ bool SimpleController::IsIssuable(BusPacket *busPacket)
 
     break;
   case WRITE_P:
+  case WRITE:
     if (bankState->currentBankState == ROW_ACTIVE &&
         bankState->openRowAddress == busPacket->row &&
         currentClockCycle >= bankState->nextWrite &&
+        currentClockCycle >= rankTimings[rank].nextWrite &&
+        currentClockCycle >= otherRankWrite.Get(rank) &&
         (channel->readReturnQueue.size() + outstandingReads) * (burstLength * DRAM_BUS_WIDTH) < CHANNEL_RETURN_Q_MAX) {
       return true;
     }
@@ -457,9 +480,12 @@ bool SimpleController::IsIssuable(BusPacket *busPacket)
     }
     break;
   case ACTIVATE:
+    while (!tFAWWindow[rank].empty() && tFAWWindow[rank].front() <= currentClockCycle)
+      tFAWWindow[rank].pop_front();
     return (bankState->currentBankState == IDLE &&
             currentClockCycle >= bankState->nextActivate &&
-            refreshCounters[rank] > 0 &&
+            currentClockCycle >= rankTimings[rank].nextActivate &&
+            currentClockCycle < refreshCycles[rank] &&
             tFAWWindow[rank].size() < 4);
   default:
     ERROR("== Error - Checking issuability on unknown packet type");
@@ -467,6 +493,157 @@ bool SimpleController::IsIssuable(BusPacket *busPacket)
   }
 }
 
+//open and not closing by an auto-precharge
+bool SimpleController::IsRowOpen(BankState *bankState)
+{
+  return (bankState->currentBankState == ROW_ACTIVE &&
+          bankState->lastCommand != READ_P &&
+          bankState->lastCommand != WRITE_P);
+}
+
+//keeps the number of banks per state up to date
+void SimpleController::SetBankState(unsigned rank, unsigned bank, CurrentBankState state)
+{
+  bankStateCounts[rank][bankStates[rank][bank].currentBankState]--;
+  bankStateCounts[rank][state]++;
+  bankStates[rank][bank].currentBankState = state;
+}
+
+//the first issuable command of a bank: a column command to the open row, else its next ACTIVATE
+bool SimpleController::FindCandidate(unsigned rank, unsigned bank, BankCandidate *candidate)
+{
+  BankQueue *queue = &bankQueues[rank][bank];
+  BankState *bankstate = &bankStates[rank][bank];
+  candidate->bank = rank * NUM_BANKS + bank;
+
+  if (ROW_BUFFER_POLICY != CLOSE_PAGE)
+    TakeRowHits(rank, bank);
+
+  for (unsigned i = 0; i < queue->columns.size(); i++) {
+    if (IsIssuable(queue->columns[i].column)) {
+      candidate->column = true;
+      candidate->precharge = false;
+      candidate->index = i;
+      candidate->order = queue->columns[i].order;
+      return true;
+    }
+  }
+
+  //an ACTIVATE can't go as long as the row is in use
+  if (!queue->columns.empty() || queue->pending.empty())
+    return false;
+
+  PendingTransaction *trans = &queue->pending.front();
+  if (ROW_BUFFER_POLICY != CLOSE_PAGE && IsRowOpen(bankstate)) {
+    //a hit waits for the refresh to close the row
+    if (bankstate->openRowAddress == trans->activate->row ||
+        currentClockCycle < bankstate->nextPrecharge)
+      return false;
+    candidate->precharge = true;
+  }
+  else if (IsIssuable(trans->activate))
+    candidate->precharge = false;
+  else
+    return false;
+
+  candidate->column = false;
+  candidate->order = trans->order;
+  return true;
+}
+
+//pending transactions to the open row don't need their ACTIVATE
+void SimpleController::TakeRowHits(unsigned rank, unsigned bank)
+{
+  BankQueue *queue = &bankQueues[rank][bank];
+  BankState *bankstate = &bankStates[rank][bank];
+  if (!IsRowOpen(bankstate) || currentClockCycle >= refreshCycles[rank])
+    return;
+
+  deque<PendingTransaction>::iterator it = queue->pending.begin();
+  while (it != queue->pending.end()) {
+    if ((*it).activate->row == bankstate->openRowAddress) {
+      RowAccess(rank, bank, (*it).activate->row, true);
+      queue->AddColumn(*it);
+      delete (*it).activate;
+      it = queue->pending.erase(it);
+    }
+    //with FR_FCFS hits overtake older conflicts of the bank
+    else if (COMMAND_SCHEDULER == FR_FCFS)
+      ++it;
+    else
+      break;
+  }
+}
+
+//decides, whether a column command leaves its row open (READ/WRITE) or closes it (READ_P/WRITE_P)
+bool SimpleController::KeepRowOpen(BusPacket *busPacket)
+{
+  BankQueue *queue = &bankQueues[busPacket->rank][busPacket->bank];
+
+  //other column commands rely on the row
+  if (ROW_BUFFER_POLICY == OPEN_PAGE || !queue->columns.empty())
+    return true;
+
+  //the next queued access to the bank tells for sure, otherwise it's up to the predictor
+  if (!queue->pending.empty())
+    return (queue->pending.front().activate->row == busPacket->row);
+  return (rowBuffers[busPacket->rank][busPacket->bank].predictor >= 2);
+}
+
+void SimpleController::IssuePrecharge(unsigned rank, unsigned bank)
+{
+  BankState *bankstate = &bankStates[rank][bank];
+  BusPacket *prechargePacket = new BusPacket(PRECHARGE, -1, 0, bankstate->openRowAddress, rank, bank, 0, channel->channelID, 0, false, 0);
+  channel->ReceiveOnCmdBus(prechargePacket);
+
+  SetBankState(rank, bank, PRECHARGING);
+  bankstate->lastCommand = PRECHARGE;
+  stateChanges.ScheduleStateChange(currentClockCycle, tRP, rank * NUM_BANKS + bank, bankstate);
+  bankstate->nextActivate = max(bankstate->nextActivate, currentClockCycle + tRP);
+}
+
+//precharges the first open row of the rank, which was not accessed for idle cycles
+bool SimpleController::CloseIdleRow(unsigned rank, uint64_t idle)
+{
+  for (unsigned b = 0; b < NUM_BANKS; b++) {
+    BankState *bankstate = &bankStates[rank][b];
+    RowBufferState *rowbuf = &rowBuffers[rank][b];
+    if (IsRowOpen(bankstate) && bankQueues[rank][b].columns.empty() &&
+        currentClockCycle >= bankstate->nextPrecharge &&
+        currentClockCycle - rowbuf->lastAccess >= idle) {
+      IssuePrecharge(rank, b);
+      return true;
+    }
+  }
+  return false;
+}
+
+//classifies the access and trains the hit predictor
+void SimpleController::RowAccess(unsigned rank, unsigned bank, unsigned row, bool hit)
+{
+  RowBufferState *rowbuf = &rowBuffers[rank][bank];
+  bool keep_open;
+  if (hit) {
+    rowbuf->hits++;
+    keep_open = true;
+  }
+  else if (rowbuf->conflict) {
+    rowbuf->conflicts++;
+    rowbuf->conflict = false;
+    keep_open = false;
+  }
+  else {
+    rowbuf->misses++;
+    keep_open = (rowbuf->lastRow == row); //closed too early
+  }
+
+  if (keep_open)
+    rowbuf->predictor += (rowbuf->predictor < 3);
+  else
+    rowbuf->predictor -= (rowbuf->predictor > 0);
+  rowbuf->lastRow = row;
+}
+
 void SimpleController::AddTransaction(Transaction *trans)
 {
   //map physical address to rank/bank/row/col
@@ -511,18 +688,13 @@ void SimpleController::AddTransaction(Transaction *trans)
   }
 
   //if requests from logic ops have priority, put them at the front so they go first
-  if (GIVE_LOGIC_PRIORITY && originatedFromLogicOp) {
-    //create column write bus packet and add it to command queue
-    this->commandQueue.push_front(action);
-    //since we're pushing front, add the ACT after so it ends up being first
-    this->commandQueue.push_front(activate);
-  }
-  else {
-    //create the row activate bus packet and add it to command queue
-    this->commandQueue.push_back(activate);
-    //create column write bus packet and add it to command queue
-    this->commandQueue.push_back(action);
-  }
+  BankQueue *queue = &this->bankQueues[mappedRank][mappedBank];
+  if (queue->empty())
+    this->queuedBanks.push_back(mappedRank * NUM_BANKS + mappedBank);
+  if (GIVE_LOGIC_PRIORITY && originatedFromLogicOp)
+    queue->pending.push_front(PendingTransaction(this->nextPriorityOrder--, activate, action));
+  else
+    queue->pending.push_back(PendingTransaction(this->nextOrder++, activate, action));
 
   waitingACTS++;
 }
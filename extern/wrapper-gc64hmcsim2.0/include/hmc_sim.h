@@ -232,6 +232,27 @@ int	hmcsim_send( struct hmcsim_t *hmc, unsigned slidId, uint64_t *packet );
 
 int	hmcsim_recv( struct hmcsim_t *hmc, uint32_t dev, uint32_t link, uint64_t *packet );
 
+/*!	\fn int hmcsim_send_burst( struct hmcsim_t *hmc, unsigned slidId, uint64_t **packets, uint32_t num )
+	\brief Sends the target packets in order, as long as the link has space
+	\param *hmc is a pointer to a valid and initialized hmc structure.  Must not be null. 
+	\param slidId is the source link id to send the packets over
+	\param **packets is an array of num pointers to valid packet structures
+	\param num is the number of packets to send
+	\return the number of packets sent, the remaining ones stalled
+*/
+int	hmcsim_send_burst( struct hmcsim_t *hmc, unsigned slidId, uint64_t **packets, uint32_t num );
+
+/*!	\fn int hmcsim_recv_burst( struct hmcsim_t *hmc, uint32_t dev, uint32_t link, uint64_t **packets, uint32_t max )
+	\brief Receives all response packets, which are available on the link (up to max)
+	\param *hmc is a pointer to a valid and initialized hmc structure.  Must not be null. 
+	\param dev is the target device cube ID [cub] to poll for response packets
+	\param link is the target link on the respective cube device to poll for response packets
+	\param **packets is an array of max pointers to memory-back packet arrays
+	\param max is the maximum number of packets to receive
+	\return the number of packets received
+*/
+int	hmcsim_recv_burst( struct hmcsim_t *hmc, uint32_t dev, uint32_t link, uint64_t **packets, uint32_t max );
+
 /*!	\fn int hmcsim_clock( struct hmcsim_t *hmc )
 	\brief Instantiates a single leading edge and falling edge clock cycle on all devices  
 	\param *hmc is a pointer to a valid and initialized hmc structure.  Must not be null. 
@@ -297,6 +318,36 @@ int	hmcsim_util_set_all_max_blocksize( struct hmcsim_t *hmc, uint32_t bsize );
 */
 int	hmcsim_util_get_max_blocksize( struct hmcsim_t *hmc, uint32_t dev, uint32_t *bsize );
 
+/*!	\fn int hmcsim_get_counter( struct hmcsim_t *hmc, const char *name, uint64_t *value )
+	\brief Reads a performance counter, e.g. "cube0.quad1.vault2.rqsts" (needs HMC_USES_COUNTERS)
+	\param *hmc is a pointer to a valid and initialized hmc structure.  Must not be null.
+	\param *name is the counter's name, as listed by hmcsim_dump_counters
+	\param *value is a pointer to a valid uint64_t location that will contain the counter
+	\return 0 on success, nonzero otherwise
+*/
+int	hmcsim_get_counter( struct hmcsim_t *hmc, const char *name, uint64_t *value );
+
+/*!	\fn int hmcsim_dump_counters( struct hmcsim_t *hmc, const char *file, uint64_t interval, int json )
+	\brief Dumps all performance counters every interval cycles and at the end (needs HMC_USES_COUNTERS)
+	\param *hmc is a pointer to a valid and initialized hmc structure.  Must not be null.
+	\param *file is the output file, it is overwritten
+	\param interval is the amount of cycles between two dumps, 0 to only dump at the end
+	\param json selects JSON Lines instead of CSV
+	\return 0 on success, nonzero otherwise
+*/
+int	hmcsim_dump_counters( struct hmcsim_t *hmc, const char *file, uint64_t interval, int json );
+
+/*!	\fn int hmcsim_get_latency( struct hmcsim_t *hmc, uint32_t group, uint32_t id, double percentile, uint64_t *cycles )
+	\brief Gets a percentile of the request latency, from send till receive (needs HMC_USES_LATENCY)
+	\param *hmc is a pointer to a valid and initialized hmc structure.  Must not be null.
+	\param group selects what id is: 0 all (id 0), 1 slid, 2 cube, 3 vault (cube * 32 + vault), 4 request command
+	\param id is the slid, cube, vault or command
+	\param percentile is the percentile in [0, 100], e.g. 99.9
+	\param *cycles is a pointer to a valid uint64_t location that will contain the latency in cycles
+	\return 0 on success, nonzero otherwise (e.g. no response received yet)
+*/
+int	hmcsim_get_latency( struct hmcsim_t *hmc, uint32_t group, uint32_t id, double percentile, uint64_t *cycles );
+
 /*!
         \fn int hmcsim_load_cmc( struct hmcsim_t *cmc, char *cmc_lib )
         \brief Load the CMC library into the current simulation context
@@ -118,10 +118,24 @@ int hmcsim_send( struct hmcsim_t *hmc, unsigned slidId, uint64_t *packet )
 int hmcsim_recv( struct hmcsim_t *hmc, uint32_t dev, uint32_t link, uint64_t *packet )
 {
   hmc_sim* hmcsim = (hmc_sim*)hmc->hmcsim;
-  return ((slid_notifier->get_notification() & (1 << link))
+  return (slid_notifier->get_notification().test(link)
           && hmcsim->hmc_recv_pkt(link, (char*)packet)) ? HMC_OK : HMC_STALL;
 }
 
+int hmcsim_send_burst( struct hmcsim_t *hmc, unsigned slidId, uint64_t **packets, uint32_t num )
+{
+  hmc_sim* hmcsim = (hmc_sim*)hmc->hmcsim;
+  return hmcsim->hmc_send_pkts(slidId, (char**)packets, num);
+}
+
+int hmcsim_recv_burst( struct hmcsim_t *hmc, uint32_t dev, uint32_t link, uint64_t **packets, uint32_t max )
+{
+  hmc_sim* hmcsim = (hmc_sim*)hmc->hmcsim;
+  if (!slid_notifier->get_notification().test(link))
+    return 0;
+  return hmcsim->hmc_recv_pkts(link, (char**)packets, max);
+}
+
 int hmcsim_clock( struct hmcsim_t *hmc )
 {
   hmc_sim* hmcsim = (hmc_sim*)hmc->hmcsim;
@@ -228,6 +242,38 @@ int hmcsim_util_get_max_blocksize( struct hmcsim_t *hmc, uint32_t dev, uint32_t
   return 0;
 }
 
+int hmcsim_get_counter( struct hmcsim_t *hmc, const char *name, uint64_t *value )
+{
+#ifdef HMC_USES_COUNTERS
+  hmc_sim *sim = (hmc_sim*)hmc->hmcsim;
+  return sim->hmc_get_counter(name, value) ? 0 : -1;
+#else
+  return -1;
+#endif /* #ifdef HMC_USES_COUNTERS */
+}
+
+int hmcsim_dump_counters( struct hmcsim_t *hmc, const char *file, uint64_t interval, int json )
+{
+#ifdef HMC_USES_COUNTERS
+  hmc_sim *sim = (hmc_sim*)hmc->hmcsim;
+  return sim->hmc_dump_counters(file, interval, json != 0) ? 0 : -1;
+#else
+  return -1;
+#endif /* #ifdef HMC_USES_COUNTERS */
+}
+
+int hmcsim_get_latency( struct hmcsim_t *hmc, uint32_t group, uint32_t id, double percentile, uint64_t *cycles )
+{
+#ifdef HMC_USES_LATENCY
+  hmc_sim *sim = (hmc_sim*)hmc->hmcsim;
+  if (group >= HMC_LAT_GROUPS)
+    return -1;
+  return sim->hmc_get_latency((enum hmc_latency_group)group, id, percentile, cycles) ? 0 : -1;
+#else
+  return -1;
+#endif /* #ifdef HMC_USES_LATENCY */
+}
+
 int hmcsim_load_cmc( struct hmcsim_t *hmc, char *cmc_lib )
 {
 
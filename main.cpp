@@ -1,183 +1,570 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <getopt.h>
 #include <sys/time.h>
 #include <inttypes.h>
 #include <math.h>
 #include "src/hmc_sim.h"
+#include "src/hmc_decode.h"
+#include "src/hmc_host.h"
 
-int main(int argc, char* argv[])
-{
-  uint64_t issue_sum = 60000;
-  float percentage_rd = 1.00;
+#define RECV_BURST  16
+#define TAGS        0x800   // 11 bit tag
 
-  unsigned use_slids = 1;
+/*
+ * Load generator / benchmark driver. Everything can be given on the command
+ * line (--key value) or by a config file (--config file, one "key value" or
+ * "key = value" per line, # comments), later settings override earlier ones.
+ * The defaults are the classic run: 60000 RD256 to address 0 of cube 0.
+ */
+enum pattern_t {
+  PATTERN_FIXED,      // always --base
+  PATTERN_SEQ,        // --base + i * size
+  PATTERN_STRIDE,     // --base + i * --stride
+  PATTERN_RANDOM,     // uniform over the capacity
+  PATTERN_HOTSPOT,    // --hot-fraction into [--base, --base + --hot-size), random otherwise
+  PATTERN_CONFLICT    // random rows of bank 0 in vault 0 of quad 0
+};
 
+enum topology_t {
+  TOPOLOGY_NONE,      // cube 0 only
+  TOPOLOGY_PAIR,      // cube 0 <-> cube 1 by two links
+  TOPOLOGY_CHAIN      // cube i <-> cube i+1 by two links each
+};
+
+struct bench_cfg {
+  uint64_t requests = 60000;
+  float percentage_rd = 1.00;
   unsigned size = 256;
-  hmc_rqst_t hmc_wr;
-  hmc_rqst_t hmc_rd;
+  unsigned cubes = 4;
+  unsigned capacity = 4;
+  unsigned slids = 1;
+  enum topology_t topology = TOPOLOGY_PAIR;
+  int multipath = -1;         // enum hmc_multipath, -1: env HMCSIM_MULTIPATH
+  int destcub = 0;            // -1: round robin over all reachable cubes
+  enum pattern_t pattern = PATTERN_FIXED;
+  uint64_t base = 0x0;
+  uint64_t stride = 4096;
+  uint64_t hot_size = 64 * 1024;
+  float hot_fraction = 0.9;
+  unsigned window = 0;        // max. outstanding requests, 0: unlimited
+  double rate = 0.0;          // open loop: requests per cycle, 0: closed loop
+  unsigned seed = 100;
+  // jump over cycles, in which the host can't do anything anyway
+  bool clock_skip = (getenv("HMCSIM_CLOCK_SKIP") != nullptr);
+  // encode into pooled packets and read the responses in place
+  bool zero_copy = (getenv("HMCSIM_ZERO_COPY") != nullptr);
+  // let hmc_host drive the slids: tags per slid, --window per slid
+  bool host = false;
+};
+
+static const struct option long_options[] = {
+  { "config",       required_argument, nullptr, 0 },
+  { "requests",     required_argument, nullptr, 0 },
+  { "reads",        required_argument, nullptr, 0 },
+  { "size",         required_argument, nullptr, 0 },
+  { "cubes",        required_argument, nullptr, 0 },
+  { "capacity",     required_argument, nullptr, 0 },
+  { "slids",        required_argument, nullptr, 0 },
+  { "topology",     required_argument, nullptr, 0 },
+  { "multipath",    required_argument, nullptr, 0 },
+  { "dest-cube",    required_argument, nullptr, 0 },
+  { "pattern",      required_argument, nullptr, 0 },
+  { "base",         required_argument, nullptr, 0 },
+  { "stride",       required_argument, nullptr, 0 },
+  { "hot-size",     required_argument, nullptr, 0 },
+  { "hot-fraction", required_argument, nullptr, 0 },
+  { "window",       required_argument, nullptr, 0 },
+  { "rate",         required_argument, nullptr, 0 },
+  { "seed",         required_argument, nullptr, 0 },
+  { "clock-skip",   no_argument,       nullptr, 0 },
+  { "zero-copy",    no_argument,       nullptr, 0 },
+  { "host",         no_argument,       nullptr, 0 },
+  { "help",         no_argument,       nullptr, 0 },
+  { nullptr,        0,                 nullptr, 0 }
+};
+
+static void usage(const char *prog)
+{
+  std::cout << "usage: " << prog << " [--key value]...\n"
+            << "  --config FILE          read \"key value\" lines, keys as below\n"
+            << "  --requests N           requests to issue (60000)\n"
+            << "  --reads PCT            share of reads in % (100)\n"
+            << "  --size BYTES           16, 32, 48, 64, 80, 96, 112, 128 or 256 (256)\n"
+            << "  --cubes N              cubes (4)\n"
+            << "  --capacity GB          4 or 8 (4)\n"
+            << "  --slids N              slids, on the free links of cube 0 (1)\n"
+            << "  --topology T           none, pair or chain (pair)\n"
+            << "  --multipath P          links between cubes: first, rr, hash or least (env HMCSIM_MULTIPATH)\n"
+            << "  --dest-cube N|all      destination cube (0)\n"
+            << "  --pattern P            fixed, seq, stride, random, hotspot or conflict (fixed)\n"
+            << "  --base ADDR            base address (0)\n"
+            << "  --stride BYTES         stride of pattern stride (4096)\n"
+            << "  --hot-size BYTES       hot region of pattern hotspot (65536)\n"
+            << "  --hot-fraction F       share of requests into the hot region (0.9)\n"
+            << "  --window N             max. outstanding requests, 0: unlimited (0)\n"
+            << "  --rate R               open loop: requests per cycle, 0: closed loop (0)\n"
+            << "  --seed N               random seed (100)\n"
+            << "  --clock-skip           skip cycles, in which the host waits (env HMCSIM_CLOCK_SKIP)\n"
+            << "  --zero-copy            send / receive pooled packets (env HMCSIM_ZERO_COPY)\n"
+            << "  --host                 run by hmc_host, --window is per slid then (closed loop only)\n";
+}
+
+static bool parse_uint(const std::string &value, uint64_t *res)
+{
+  char *end;
+  *res = strtoull(value.c_str(), &end, 0);
+  return !value.empty() && *end == '\0';
+}
+
+static bool parse_double(const std::string &value, double *res)
+{
+  char *end;
+  *res = strtod(value.c_str(), &end);
+  return !value.empty() && *end == '\0';
+}
+
+static bool read_config(struct bench_cfg *cfg, const char *file);
+
+static bool set_option(struct bench_cfg *cfg, const std::string &key, const std::string &value)
+{
+  uint64_t u;
+  double d;
+  bool ok = true;
+
+  if(key == "config")
+    return read_config(cfg, value.c_str());
+  else if(key == "requests")
+    ok = parse_uint(value, &cfg->requests) && cfg->requests;
+  else if(key == "reads") {
+    ok = parse_double(value, &d) && d >= 0.0 && d <= 100.0;
+    cfg->percentage_rd = d / 100.0;
+  }
+  else if(key == "size") {
+    ok = parse_uint(value, &u);
+    switch(u) {
+    case 16: case 32: case 48: case 64: case 80: case 96: case 112: case 128: case 256:
+      cfg->size = u;
+      break;
+    default:
+      ok = false;
+    }
+  }
+  else if(key == "cubes") {
+    ok = parse_uint(value, &u) && u && u <= HMC_MAX_DEVS;
+    cfg->cubes = u;
+  }
+  else if(key == "capacity") {
+    ok = parse_uint(value, &u) && (u == 4 || u == 8);
+    cfg->capacity = u;
+  }
+  else if(key == "slids") {
+    ok = parse_uint(value, &u) && u && u <= HMC_MAX_LINKS;
+    cfg->slids = u;
+  }
+  else if(key == "topology") {
+    if(value == "none")
+      cfg->topology = TOPOLOGY_NONE;
+    else if(value == "pair")
+      cfg->topology = TOPOLOGY_PAIR;
+    else if(value == "chain")
+      cfg->topology = TOPOLOGY_CHAIN;
+    else
+      ok = false;
+  }
+  else if(key == "multipath") {
+    if(value == "first")
+      cfg->multipath = HMC_MULTIPATH_FIRST;
+    else if(value == "rr")
+      cfg->multipath = HMC_MULTIPATH_RR;
+    else if(value == "hash")
+      cfg->multipath = HMC_MULTIPATH_HASH;
+    else if(value == "least")
+      cfg->multipath = HMC_MULTIPATH_LEAST;
+    else
+      ok = false;
+  }
+  else if(key == "dest-cube") {
+    if(value == "all")
+      cfg->destcub = -1;
+    else {
+      ok = parse_uint(value, &u) && u < HMC_MAX_DEVS;
+      cfg->destcub = u;
+    }
+  }
+  else if(key == "pattern") {
+    if(value == "fixed")
+      cfg->pattern = PATTERN_FIXED;
+    else if(value == "seq")
+      cfg->pattern = PATTERN_SEQ;
+    else if(value == "stride")
+      cfg->pattern = PATTERN_STRIDE;
+    else if(value == "random")
+      cfg->pattern = PATTERN_RANDOM;
+    else if(value == "hotspot")
+      cfg->pattern = PATTERN_HOTSPOT;
+    else if(value == "conflict")
+      cfg->pattern = PATTERN_CONFLICT;
+    else
+      ok = false;
+  }
+  else if(key == "base")
+    ok = parse_uint(value, &cfg->base);
+  else if(key == "stride")
+    ok = parse_uint(value, &cfg->stride);
+  else if(key == "hot-size")
+    ok = parse_uint(value, &cfg->hot_size) && cfg->hot_size;
+  else if(key == "hot-fraction") {
+    ok = parse_double(value, &d) && d >= 0.0 && d <= 1.0;
+    cfg->hot_fraction = d;
+  }
+  else if(key == "window") {
+    ok = parse_uint(value, &u);
+    cfg->window = u;
+  }
+  else if(key == "rate")
+    ok = parse_double(value, &cfg->rate) && cfg->rate >= 0.0;
+  else if(key == "seed") {
+    ok = parse_uint(value, &u);
+    cfg->seed = u;
+  }
+  else if(key == "clock-skip")
+    cfg->clock_skip = (value != "0");
+  else if(key == "zero-copy")
+    cfg->zero_copy = (value != "0");
+  else if(key == "host")
+    cfg->host = (value != "0");
+  else {
+    std::cerr << "ERROR: unknown option '" << key << "'!" << std::endl;
+    return false;
+  }
+
+  if(!ok)
+    std::cerr << "ERROR: option '" << key << "' has wrong value! " << value << std::endl;
+  return ok;
+}
+
+static bool read_config(struct bench_cfg *cfg, const char *file)
+{
+  std::ifstream in(file);
+  if(!in) {
+    std::cerr << "ERROR: couldn't open config '" << file << "'!" << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::replace(line.begin(), line.end(), '=', ' ');
+    std::istringstream ss(line);
+    std::string key, value;
+    if(!(ss >> key))
+      continue;
+    if(!(ss >> value))
+      value = "1";
+    if(!set_option(cfg, key, value))
+      return false;
+  }
+  return true;
+}
+
+static bool parse_args(struct bench_cfg *cfg, int argc, char* argv[])
+{
+  int idx;
+  int c;
+  while((c = getopt_long(argc, argv, "", long_options, &idx)) != -1) {
+    if(c != 0)
+      return false;
+    std::string key = long_options[idx].name;
+    if(key == "help") {
+      usage(argv[0]);
+      exit(0);
+    }
+    if(!set_option(cfg, key, optarg ? optarg : "1"))
+      return false;
+  }
+  if(optind < argc) {
+    std::cerr << "ERROR: unexpected argument '" << argv[optind] << "'!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static hmc_rqst_t size_to_cmd(unsigned size, bool is_load)
+{
   switch(size) {
-  case 16:
-    hmc_wr = WR16;
-    hmc_rd = RD16;
-    break;
-  case 32:
-    hmc_wr = WR32;
-    hmc_rd = RD32;
-    break;
-  case 48:
-    hmc_wr = WR48;
-    hmc_rd = RD48;
-    break;
-  case 64:
-    hmc_wr = WR64;
-    hmc_rd = RD64;
-    break;
-  case 80:
-    hmc_wr = WR80;
-    hmc_rd = RD80;
-    break;
-  case 96:
-    hmc_wr = WR96;
-    hmc_rd = RD96;
-    break;
-  case 112:
-    hmc_wr = WR112;
-    hmc_rd = RD112;
-    break;
-  case 128:
-    hmc_wr = WR128;
-    hmc_rd = RD128;
-    break;
-  default:
-  case 256:
-    hmc_wr = WR256;
-    hmc_rd = RD256;
-    break;
+  case 16:  return is_load ? RD16 : WR16;
+  case 32:  return is_load ? RD32 : WR32;
+  case 48:  return is_load ? RD48 : WR48;
+  case 64:  return is_load ? RD64 : WR64;
+  case 80:  return is_load ? RD80 : WR80;
+  case 96:  return is_load ? RD96 : WR96;
+  case 112: return is_load ? RD112 : WR112;
+  case 128: return is_load ? RD128 : WR128;
+  default:  return is_load ? RD256 : WR256;
   }
+}
 
+int main(int argc, char* argv[])
+{
+  struct bench_cfg cfg;
+  if(!parse_args(&cfg, argc, argv)) {
+    usage(argv[0]);
+    return -1;
+  }
+  if(cfg.host && cfg.rate > 0.0) {
+    std::cerr << "ERROR: --host runs closed loop only, --rate can't be used!" << std::endl;
+    return -1;
+  }
 
-  unsigned cubes = 4;
-  unsigned capacity = 4;
-  hmc_sim sim(cubes, 4, 4, capacity, HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR30);
-  unsigned destcub = 0; // 1
+  hmc_sim sim(cfg.cubes, 4, 4, cfg.capacity, HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR30);
+  if(cfg.multipath >= 0)
+    sim.hmc_set_multipath((enum hmc_multipath)cfg.multipath);
 
 #ifdef HMC_USES_GRAPHVIZ
-  // if GRAPHVIZ is enabled!
+  // if GRAPHVIZ is enabled, the topology comes from the graph!
   hmc_notify* slidnotify = sim.hmc_get_slid_notify();
   if(slidnotify == nullptr) {
     std::cerr << "initialisation failed!" << std::endl;
     exit(-1);
   }
+  unsigned reachable = cfg.cubes;
 #else
+  // links 1 and 3 lead to the next cube, 0 and 2 to the previous one
+  unsigned reachable = 1;
+  bool ret = true;
+  if(cfg.topology != TOPOLOGY_NONE) {
+    unsigned last = (cfg.topology == TOPOLOGY_PAIR) ? 1 : cfg.cubes - 1;
+    if(last >= cfg.cubes) {
+      std::cerr << "ERROR: topology needs at least 2 cubes!" << std::endl;
+      return -1;
+    }
+    for(unsigned cub = 0; cub < last; cub++) {
+      ret &= sim.hmc_set_link_config(cub, 1, cub + 1, 0, HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR30);
+      ret &= sim.hmc_set_link_config(cub, 3, cub + 1, 2, HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR30);
+    }
+    reachable = last + 1;
+  }
 
-  hmc_notify* slidnotify;
-  for(unsigned slid=0; slid<use_slids; slid++)
-    slidnotify = sim.hmc_define_slid(slid, 0, slid, HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR15);
+  std::vector<unsigned> free_links;
+  for(unsigned link = 0; link < 4; link++) {
+    if(cfg.topology == TOPOLOGY_NONE || !(link & 0x1))
+      free_links.push_back(link);
+  }
+  if(cfg.slids > free_links.size()) {
+    std::cerr << "ERROR: only " << free_links.size() << " links of cube 0 are left for slids!" << std::endl;
+    return -1;
+  }
+  hmc_notify* slidnotify = nullptr;
+  for(unsigned slid=0; slid<cfg.slids; slid++)
+    slidnotify = sim.hmc_define_slid(slid, 0, free_links[slid], HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR15);
 
-  bool ret = sim.hmc_set_link_config(0, 1, 1, 0, HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR30);
-  ret &= sim.hmc_set_link_config(0, 3, 1, 2, HMCSIM_FULL_LINK_WIDTH, HMCSIM_BR30);
   if (!ret || slidnotify == nullptr) {
     std::cerr << "link setup was not successful" << std::endl;
     return -1;
   }
 #endif /* #ifdef HMC_USES_GRAPHVIZ */
+  if(cfg.destcub >= (int)reachable) {
+    std::cerr << "ERROR: cube " << cfg.destcub << " is not reachable!" << std::endl;
+    return -1;
+  }
 
-  srand(100);
-
-  uint64_t issue_writes = issue_sum * (1-percentage_rd);
-  uint64_t issue_reads = issue_sum - issue_writes;
+  std::mt19937_64 rng(cfg.seed);
+  uint64_t cap_bytes = (uint64_t)cfg.capacity << 30;
+  uint64_t align = ~((0x1ull << (unsigned)log2(cfg.size)) - 1);
 
+  uint64_t issue_writes = cfg.requests * (1-cfg.percentage_rd);
+  uint64_t issue_reads = cfg.requests - issue_writes;
 
-  unsigned clks = 0;
+  uint64_t clks = 0;
   uint64_t send_ctr = 0;
   uint64_t recv_ctr = 0;
-  unsigned *track = new unsigned[issue_sum];
+  uint64_t gen_clk = 0;
+  // cycle each request was sent (open loop: was due), in the order of issue, per tag
+  std::vector<std::deque<uint64_t> > pending(TAGS);
+  std::vector<uint64_t> latencies;
+  latencies.reserve(cfg.requests);
   char packet[(17*FLIT_WIDTH) / (sizeof(char)*8)];
-  char retpacket[17*FLIT_WIDTH / (sizeof(char)*8)];
+  std::vector<std::vector<char> > retbufs(RECV_BURST, std::vector<char>(17*FLIT_WIDTH / (sizeof(char)*8)));
+  char *retpackets[RECV_BURST];
+  for(unsigned i = 0; i < RECV_BURST; i++)
+    retpackets[i] = retbufs[i].data();
+  char *sendpacket = packet;
+  auto recv_one = [&](char *rsp) {
+                    std::deque<uint64_t> &q = pending[HMCSIM_PACKET_RESPONSE_GET_TAG(HMC_PACKET_HEADER(rsp))];
+                    if(!q.empty()) {
+                      latencies.push_back(clks - q.front());
+                      q.pop_front();
+                    }
+                    recv_ctr++;
+                  };
+  // the n-th request, false if all are out
+  auto next_rqst = [&](uint64_t n, struct hmc_host_rqst *rqst) -> bool {
+                     if(!(issue_reads || issue_writes))
+                       return false;
+
+                     uint64_t addr;
+                     switch(cfg.pattern) {
+                     case PATTERN_SEQ:
+                       addr = cfg.base + n * cfg.size;
+                       break;
+                     case PATTERN_STRIDE:
+                       addr = cfg.base + n * cfg.stride;
+                       break;
+                     case PATTERN_RANDOM:
+                     case PATTERN_CONFLICT:
+                       addr = rng();
+                       break;
+                     case PATTERN_HOTSPOT:
+                       if(std::uniform_real_distribution<float>(0.0, 1.0)(rng) < cfg.hot_fraction)
+                         addr = cfg.base + rng() % cfg.hot_size;
+                       else
+                         addr = rng();
+                       break;
+                     default:
+                       addr = cfg.base;
+                       break;
+                     }
+                     // alignment to block size:
+                     addr = (addr % cap_bytes) & align;
+
+                     bool is_load = (rng() % (issue_reads + issue_writes)) < issue_reads;
+                     if(is_load)
+                       issue_reads--;
+                     else
+                       issue_writes--;
+                     rqst->cmd = size_to_cmd(cfg.size, is_load);
+                     rqst->cube = (cfg.destcub < 0) ? n % reachable : cfg.destcub;
+                     if(cfg.pattern == PATTERN_CONFLICT) {
+                       // the simulator knows where bank 0 is
+                       sim.hmc_encode_pkt(rqst->cube, 0, 0, 0, addr >> 32, 0, rqst->cmd, packet);
+                       addr = HMCSIM_PACKET_REQUEST_GET_ADRS(HMC_PACKET_HEADER(packet));
+                     }
+                     rqst->addr = addr;
+                     rqst->cookie = nullptr;
+                     return true;
+                   };
 
   struct timeval t1, t2;
   gettimeofday(&t1, NULL);
 
-  bool next_available = false;
-  unsigned slidId = 0;
-  do
-  {
-    if((issue_reads || issue_writes)
-       && next_available == false)
+  if(cfg.host) {
+    std::vector<unsigned> slids;
+    for(unsigned slid = 0; slid < cfg.slids; slid++)
+      slids.push_back(slid);
+    hmc_host host(&sim, slids, cfg.window ? cfg.window : HMC_HOST_TAGS);
+    host.set_callback([&](const struct hmc_host_cpl *cpl) {
+                        if(cpl->packet != nullptr)
+                          latencies.push_back(cpl->latency);
+                        recv_ctr++;
+                      });
+    clks = host.run(next_rqst, cfg.clock_skip);
+    send_ctr = host.get_sent();
+  }
+  else {
+    bool next_available = false;
+    unsigned slidId = 0;
+    do
     {
-      unsigned addr = 0x0;
-      // ToDo: address alignment depending on size!
-      //addr |= (send_ctr & 0x1F) << 7; // quad + vault
-      //addr |= (send_ctr & 0x3) << 10;
-
-      // alignment to block size:
-      addr &= ~((0x1ull << (unsigned)log2(size)) - 1);
-
-      bool is_load = (bool)(rand() & 0x1);
-      if(is_load && !issue_reads)
-        is_load = false;
-      if(!is_load && !issue_writes)
-        is_load = true;
-
-//      unsigned dram_hi = (send_ctr & 0b111) << 4;
-//      unsigned dram_lo = (send_ctr >> 3) << (capacity == 8 ? 16 : 15);
-//      addr |= dram_hi | dram_lo;
-      if(is_load) {
-        issue_reads--;
-        sim.hmc_encode_pkt(destcub, addr, send_ctr /* tag */, hmc_rd, packet);
-      }
-      else {
-        issue_writes--;
-        sim.hmc_encode_pkt(destcub, addr, send_ctr /* tag */, hmc_wr, packet);
+      bool window_full = cfg.window && (send_ctr - recv_ctr >= cfg.window);
+      uint64_t due = (cfg.rate > 0.0) ? (uint64_t)(send_ctr / cfg.rate) : 0;
+      if((issue_reads || issue_writes)
+         && next_available == false && !window_full && clks >= due)
+      {
+        struct hmc_host_rqst rqst;
+        next_rqst(send_ctr, &rqst);
+        if(cfg.zero_copy)
+          sendpacket = sim.hmc_alloc_pkt(HMC_MAX_FLITS_PER_PACKET);
+        sim.hmc_encode_pkt(rqst.cube, rqst.addr, send_ctr & (TAGS - 1) /* tag */, rqst.cmd, sendpacket);
+        gen_clk = (cfg.rate > 0.0) ? due : clks;
+        next_available = true;
       }
-      next_available = true;
-    }
 
-    if(next_available == true
-       && sim.hmc_send_pkt(slidId, packet))
-    {
-      track[send_ctr] = clks;
-      send_ctr++;
-      next_available = false;
-      if(++slidId >= use_slids)
-        slidId = 0;
-    }
-
-    for(unsigned slid = 0; slid < use_slids; slid++)
-      if(slidnotify->get_notification()
-         && sim.hmc_recv_pkt(slid, retpacket))
+      if(next_available == true
+         && (cfg.zero_copy ? sim.hmc_send_pkt_owned(slidId, sendpacket)
+                           : sim.hmc_send_pkt(slidId, sendpacket)))
       {
-        track[recv_ctr] = clks - track[recv_ctr];
-        recv_ctr++;
+        pending[send_ctr & (TAGS - 1)].push_back((cfg.rate > 0.0) ? gen_clk : clks);
+        send_ctr++;
+        next_available = false;
+        if(++slidId >= cfg.slids)
+          slidId = 0;
       }
-    if(recv_ctr >= issue_sum) // we always wait for all returns
-      break;
 
-    clks++;
-    //if(clks > 311)
-    //  exit(0);
-    sim.clock();
-  } while(true);
+      for(unsigned slid = 0; slid < cfg.slids; slid++) {
+        if(!slidnotify->get_notification())
+          continue;
+        // drain all responses, which are ready
+        if(cfg.zero_copy) {
+          char *rsp;
+          while((rsp = sim.hmc_recv_pkt_view(slid)) != nullptr) {
+            recv_one(rsp);
+            sim.hmc_release_pkt(rsp);
+          }
+        }
+        else {
+          unsigned received = sim.hmc_recv_pkts(slid, retpackets, RECV_BURST);
+          for(unsigned i = 0; i < received; i++)
+            recv_one(retpackets[i]);
+        }
+      }
+      if(recv_ctr >= cfg.requests) // we always wait for all returns
+        break;
+
+      // the host can't proceed: its request is stuck, all are out, the window is full or the next is not due yet
+      bool idle = next_available || !(issue_reads || issue_writes) || window_full || clks < due;
+      if(cfg.clock_skip && idle) {
+        uint64_t max = 0x100000;
+        if(!next_available && (issue_reads || issue_writes) && !window_full && clks < due && due - clks < max)
+          max = due - clks;
+        clks += sim.clock_skip(max);
+      }
+      else {
+        clks++;
+        sim.clock();
+      }
+    } while(true);
+  }
 
   gettimeofday(&t2, NULL);
 
   unsigned long long avg = 0;
-  for(unsigned i=0; i<issue_sum; i++) {
-    avg += track[i];
+  for(unsigned i=0; i<latencies.size(); i++) {
+    avg += latencies[i];
   }
-  avg /= issue_sum;
-
-  delete[] track;
+  if(!latencies.empty())
+    avg /= latencies.size();
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) -> uint64_t {
+                      if(latencies.empty())
+                        return 0;
+                      uint64_t rank = (uint64_t)ceil(p / 100.0 * latencies.size());
+                      return latencies[rank ? rank - 1 : 0];
+                    };
 
-  issue_writes = issue_sum * (1-percentage_rd);
-  issue_reads = issue_sum - issue_writes;
-  unsigned rd_size = size;
-  unsigned wr_size = size;
-  // ToDo: account not only for reads but also writes! and depending on the type send!
-  std::cout << "issued: " << issue_sum << " (rds: " << issue_reads << ", wrs: "<< issue_writes<< ")" << std::endl;
+  issue_writes = cfg.requests * (1-cfg.percentage_rd);
+  issue_reads = cfg.requests - issue_writes;
+  unsigned rd_size = cfg.size;
+  unsigned wr_size = cfg.size;
+  std::cout << "issued: " << cfg.requests << " (rds: " << issue_reads << ", wrs: "<< issue_writes<< ")" << std::endl;
   float freq = 0.8f; // we clk at the same frequency! otherwise: 0.8f
   std::cout << "done in " << clks << " clks, avg.: " << avg << std::endl;
+  std::cout << "latency: p50 " << percentile(50.0) << ", p99 " << percentile(99.0)
+            << ", p99.9 " << percentile(99.9) << ", max " << percentile(100.0) << " clks" << std::endl;
+#ifdef HMC_USES_LATENCY
+  sim.hmc_latency_report(std::cout);
+#endif /* #ifdef HMC_USES_LATENCY */
+#ifdef HMC_USES_COUNTERS
+  sim.hmc_link_report(std::cout);
+#endif /* #ifdef HMC_USES_COUNTERS */
   float rdbw_overhead = (((float)(rd_size+16)*8*issue_reads)/(clks*freq)); // Gbit/s
   float wrbw_overhead = (((float)(wr_size+(16*2))*8*issue_writes)/(clks*freq)); // Gbit/s  -> has two times the overhead!
   float bw_overhead = rdbw_overhead + wrbw_overhead;
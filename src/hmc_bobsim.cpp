@@ -3,6 +3,7 @@
 #include "hmc_cube.h"
 #include "config.h"
 #include "hmc_notify.h"
+#include "hmc_pool.h"
 
 bool callback(void *bobsim, void *packet)
 {
@@ -49,20 +50,28 @@ hmc_bobsim::~hmc_bobsim(void)
 }
 
 
-bool hmc_bobsim::bob_feedback(char *packet)
+// processes the request, which came back from bobsim, and hands the slot back to the pool
+bool hmc_bobsim::bob_retire(char *packet)
 {
-  if (this->vault.hmcsim_process_rqst(packet)) {
+  if (!this->vault.hmcsim_process_rqst(packet))
+    return false;
+
+  this->cube->get_pool()->release(packet);
 #ifdef HMC_USES_NOTIFY
-    if (this->bobnotify_ctr && !--this->bobnotify_ctr)
-      this->bobnotify.notify_del(0);
+  if (this->bobnotify_ctr && !--this->bobnotify_ctr)
+    this->bobnotify.notify_del(0);
 #endif /* #ifdef HMC_USES_NOTIFY */
+  return true;
+}
+
+bool hmc_bobsim::bob_feedback(char *packet)
+{
+  if (this->bob_retire(packet))
     return true;
-  }
-  else {
-    this->feedback_cache.push_back(packet);
+
+  this->feedback_cache.push_back(packet);
 //    std::cout << "shiiiiiiiTTTT!" << std::endl;
-    return false;
-  }
+  return false;
 }
 
 void hmc_bobsim::clock(void)
@@ -79,11 +88,12 @@ void hmc_bobsim::clock(void)
 //      std::cerr << "This can only happen, if bobsim pushes further responses,";
 //      std::cerr << " while this module can't push it further ... " << std::endl;
       bool update = true;
-      for (auto it = this->feedback_cache.begin(); it != this->feedback_cache.end(); ++it) {
-        if (!this->bob_feedback(*it)) {
+      while (!this->feedback_cache.empty()) {
+        if (!this->bob_retire(this->feedback_cache.front())) {
           update = false;
           break;
         }
+        this->feedback_cache.pop_front();
       }
       if (update)
         this->bobsim->Update();
@@ -129,7 +139,7 @@ void hmc_bobsim::clock(void)
       flits -= (flits > 0); // netto! without overhead!, because BOBSim accounts by itself for the packet overhead!
       BOBSim::Transaction *bobtrans = new BOBSim::Transaction(type, 0 /* addr */, flits, rsp_lenInFlits, packet);
 
-      unsigned long gl_bank = this->cube->HMCSIM_UTIL_DECODE_BANK(addr);
+      unsigned long gl_bank = hmc_pool::meta(packet)->bank;
       bobtrans->bank = gl_bank % HMC_NUM_BANKS_PER_RANK;
       bobtrans->rank = (gl_bank - bobtrans->bank) / HMC_NUM_BANKS_PER_RANK;
       this->cube->HMC_UTIL_DECODE_COL_AND_ROW(addr, &bobtrans->col, &bobtrans->row);
@@ -154,6 +164,26 @@ void hmc_bobsim::clock(void)
   }
 }
 
+// BOBSim itself is clocked cycle by cycle, only an idle vault can be skipped
+uint64_t hmc_bobsim::next_event(void)
+{
+#ifdef HMC_USES_NOTIFY
+  if (this->bobnotify_ctr || this->bobnotify.get_notification()
+      || !this->feedback_cache.empty()
+      || !this->link->get_rx_fifo_out()->empty())
+    return 1;
+
+  return this->link->next_event();
+#else
+  return 1;
+#endif /* #ifdef HMC_USES_NOTIFY */
+}
+
+void hmc_bobsim::fast_forward(uint64_t cycles)
+{
+  this->link->fast_forward(cycles);
+}
+
 void hmc_bobsim::bob_printStatsPeriodical(bool flag)
 {
 #ifndef BOBSIM_NO_LOG
@@ -35,83 +35,15 @@ private:
 
   enum BOBSim::TransactionType hmc_determineTransactionType(hmc_rqst_t cmd)
   {
-    switch (cmd) {
-    case RD16:
-    case RD32:
-    case RD48:
-    case RD64:
-    case RD80:
-    case RD96:
-    case RD112:
-    case RD128:
-    case RD256:
-    case MD_RD:
-      return BOBSim::DATA_READ;
-    case FLOW_NULL:
-    case PRET:
-    case TRET:
-    case IRTRY:
-    case INC8:
-    case P_INC8:
-      return BOBSim::LOGIC_OPERATION;
-    case WR16:
-    case MD_WR:
-    case BWR:
-      return BOBSim::DATA_WRITE;
-    case TWOADD8:
-    case ADD16:
-    case TWOADDS8R:
-    case ADDS16R:
-    case XOR16:
-    case OR16:
-    case NOR16:
-    case AND16:
-    case NAND16:
-    case CASGT8:
-    case CASGT16:
-    case CASLT8:
-    case CASLT16:
-    case CASEQ8:
-    case CASZERO16:
-    case EQ8:
-    case EQ16:
-      return BOBSim::LOGIC_OPERATION;
-    case BWR8R:
-      return BOBSim::DATA_WRITE;
-    case SWAP16:
-      return BOBSim::LOGIC_OPERATION;
-    case P_WR16:
-    case P_BWR:
-      return BOBSim::DATA_WRITE;
-    case P_2ADD8:
-    case P_ADD16:
-      return BOBSim::LOGIC_OPERATION;
-    case WR32:
-    case P_WR32:
-    case WR48:
-    case P_WR48:
-    case WR64:
-    case P_WR64:
-    case WR80:
-    case P_WR80:
-    case WR96:
-    case P_WR96:
-    case WR112:
-    case P_WR112:
-    case WR128:
-    case P_WR128:
-    case WR256:
-    case P_WR256:
-      return BOBSim::DATA_WRITE;
-      break;
-    default:
-      // ToDo:  if CMC!
-      // return LOGIC_OPERATION;
-      break;
-    }
-    return BOBSim::LOGIC_OPERATION;
+    static const enum BOBSim::TransactionType types[] = {
+      BOBSim::DATA_READ,        // HMC_CMD_READ
+      BOBSim::DATA_WRITE,       // HMC_CMD_WRITE
+      BOBSim::LOGIC_OPERATION   // HMC_CMD_LOGIC, ToDo: if CMC!
+    };
+    return types[hmc_cmd_get(cmd)->kind];
   }
 
+  bool bob_retire(char *packet);
   void bob_printStatsPeriodical(bool flag);
   void bob_printStats(void);
 
@@ -124,14 +56,29 @@ public:
   virtual ~hmc_bobsim(void);
 
   void clock(void);
+  uint64_t next_event(void);
+  void fast_forward(uint64_t cycles);
   bool bob_feedback(char *packet);
 
   unsigned get_id(void) { return this->id; }
+#if defined(HMC_USES_THREADS) && defined(HMC_USES_NOTIFY)
+  ALWAYS_INLINE bool get_notification(void)
+  {
+    return this->linknotify.get_notification() || this->bobnotify.get_notification();
+  }
+#endif /* #if defined(HMC_USES_THREADS) && defined(HMC_USES_NOTIFY) */
   bool set_link(unsigned linkId, hmc_link *link, hmc_link_type linkType) {
     this->link = link;
     this->vault.set_link(linkId, link, linkType);
     return true;
   }
+#ifdef HMC_USES_COUNTERS
+  // bank conflicts & co. are up to BOBSim's own stats
+  void collect_counters(hmc_counters *ctrs, const std::string &prefix)
+  {
+    this->vault.collect_counters(ctrs, prefix);
+  }
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 };
 
@@ -0,0 +1,8 @@
+#include "hmc_cmd.h"
+
+const struct hmc_cmd_table hmc_cmds = hmc_cmd_make(hmc_cmd_gen<HMC_CMD_TABLE_SIZE>::type());
+
+static_assert(hmc_cmd_describe(WR256).rqst_flits == 17, "hmc_cmds: WR256");
+static_assert(hmc_cmd_describe(RD256).rsp_flits == 17, "hmc_cmds: RD256");
+static_assert(hmc_cmd_describe(P_WR16).rsp == false, "hmc_cmds: P_WR16");
+static_assert(hmc_cmd_describe(0x7F).rqst_flits == 0, "hmc_cmds: CMC");
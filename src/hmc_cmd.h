@@ -0,0 +1,127 @@
+#ifndef _HMC_CMD_H_
+#define _HMC_CMD_H_
+
+#include <cstdint>
+#include "hmc_macros.h"
+#include "hmc_sim_t.h"
+
+/*
+ * Static properties of the request commands, looked up by the 7 bit CMD field
+ * of the header. Everything not listed is a CMC command: it can't be encoded
+ * (rqst_flits 0) and the vault answers it with an error response.
+ */
+#define HMC_CMD_TABLE_SIZE  0x80
+
+enum hmc_cmd_kind {
+  HMC_CMD_READ,
+  HMC_CMD_WRITE,
+  HMC_CMD_LOGIC
+};
+
+struct hmc_cmd_desc {
+  uint8_t rqst_flits;
+  uint8_t rsp_flits;
+  bool rsp;
+  uint8_t kind;           // enum hmc_cmd_kind, BOBSim transaction type
+  uint16_t min_bsize;     // requires a max block size of at least this (0: any)
+  hmc_response_t rsp_cmd;
+};
+
+//        cmd        rqst rsp_flits rsp_cmd   rsp    kind           min_bsize
+#define HMC_CMD_LIST(X) \
+  X(WR16,      2,  1,  WR_RS,     true,  HMC_CMD_WRITE, 0)   \
+  X(WR32,      3,  1,  WR_RS,     true,  HMC_CMD_WRITE, 0)   \
+  X(WR48,      4,  1,  WR_RS,     true,  HMC_CMD_WRITE, 48)  \
+  X(WR64,      5,  1,  WR_RS,     true,  HMC_CMD_WRITE, 64)  \
+  X(WR80,      6,  1,  WR_RS,     true,  HMC_CMD_WRITE, 80)  \
+  X(WR96,      7,  1,  WR_RS,     true,  HMC_CMD_WRITE, 96)  \
+  X(WR112,     8,  1,  WR_RS,     true,  HMC_CMD_WRITE, 112) \
+  X(WR128,     9,  1,  WR_RS,     true,  HMC_CMD_WRITE, 128) \
+  X(WR256,     17, 1,  WR_RS,     true,  HMC_CMD_WRITE, 256) \
+  X(MD_WR,     2,  1,  MD_WR_RS,  true,  HMC_CMD_WRITE, 0)   \
+  X(BWR,       2,  1,  WR_RS,     true,  HMC_CMD_WRITE, 0)   \
+  X(TWOADD8,   2,  1,  WR_RS,     true,  HMC_CMD_LOGIC, 0)   \
+  X(ADD16,     2,  1,  WR_RS,     true,  HMC_CMD_LOGIC, 0)   \
+  X(P_WR16,    2,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 0)   \
+  X(P_WR32,    3,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 0)   \
+  X(P_WR48,    4,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 48)  \
+  X(P_WR64,    5,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 64)  \
+  X(P_WR80,    6,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 80)  \
+  X(P_WR96,    7,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 96)  \
+  X(P_WR112,   8,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 112) \
+  X(P_WR128,   9,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 128) \
+  X(P_WR256,   17, 0,  RSP_ERROR, false, HMC_CMD_WRITE, 256) \
+  X(P_BWR,     2,  0,  RSP_ERROR, false, HMC_CMD_WRITE, 0)   \
+  X(P_2ADD8,   2,  0,  RSP_ERROR, false, HMC_CMD_LOGIC, 0)   \
+  X(P_ADD16,   2,  0,  RSP_ERROR, false, HMC_CMD_LOGIC, 0)   \
+  X(RD16,      1,  2,  RD_RS,     true,  HMC_CMD_READ,  0)   \
+  X(RD32,      1,  3,  RD_RS,     true,  HMC_CMD_READ,  0)   \
+  X(RD48,      1,  4,  RD_RS,     true,  HMC_CMD_READ,  48)  \
+  X(RD64,      1,  5,  RD_RS,     true,  HMC_CMD_READ,  64)  \
+  X(RD80,      1,  6,  RD_RS,     true,  HMC_CMD_READ,  80)  \
+  X(RD96,      1,  7,  RD_RS,     true,  HMC_CMD_READ,  96)  \
+  X(RD112,     1,  8,  RD_RS,     true,  HMC_CMD_READ,  112) \
+  X(RD128,     1,  9,  RD_RS,     true,  HMC_CMD_READ,  128) \
+  X(RD256,     1,  17, RD_RS,     true,  HMC_CMD_READ,  256) \
+  X(MD_RD,     1,  2,  MD_RD_RS,  true,  HMC_CMD_READ,  0)   \
+  X(FLOW_NULL, 1,  0,  RSP_ERROR, false, HMC_CMD_LOGIC, 0)   \
+  X(PRET,      1,  0,  RSP_ERROR, false, HMC_CMD_LOGIC, 0)   \
+  X(TRET,      1,  0,  RSP_ERROR, false, HMC_CMD_LOGIC, 0)   \
+  X(IRTRY,     1,  0,  RSP_ERROR, false, HMC_CMD_LOGIC, 0)   \
+  X(TWOADDS8R, 2,  2,  RD_RS,     true,  HMC_CMD_LOGIC, 0)   \
+  X(ADDS16R,   2,  2,  RD_RS,     true,  HMC_CMD_LOGIC, 0)   \
+  X(INC8,      1,  1,  WR_RS,     true,  HMC_CMD_LOGIC, 0)   \
+  X(P_INC8,    1,  0,  RSP_ERROR, false, HMC_CMD_LOGIC, 0)   \
+  X(XOR16,     2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(OR16,      2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(NOR16,     2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(AND16,     2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(NAND16,    2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(CASGT8,    2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(CASGT16,   2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(CASLT8,    2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(CASLT16,   2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(CASEQ8,    2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(CASZERO16, 2,  2,  RD_RS,     false, HMC_CMD_LOGIC, 0)   \
+  X(EQ8,       2,  1,  WR_RS,     true,  HMC_CMD_LOGIC, 0)   \
+  X(EQ16,      2,  1,  WR_RS,     true,  HMC_CMD_LOGIC, 0)   \
+  X(BWR8R,     2,  2,  RD_RS,     true,  HMC_CMD_WRITE, 0)   \
+  X(SWAP16,    2,  2,  RD_RS,     true,  HMC_CMD_LOGIC, 0)
+
+#define HMC_CMD_DESCRIBE(cmd_, rqst_, rsp_flits_, rsp_cmd_, rsp_, kind_, bsize_) \
+  (cmd == (cmd_)) ? hmc_cmd_desc{ rqst_, rsp_flits_, rsp_, kind_, bsize_, rsp_cmd_ } :
+
+constexpr struct hmc_cmd_desc hmc_cmd_describe(unsigned cmd)
+{
+  return HMC_CMD_LIST(HMC_CMD_DESCRIBE)
+         hmc_cmd_desc{ 0, 2, true, HMC_CMD_LOGIC, 0, RSP_ERROR }; // CMC
+}
+
+#undef HMC_CMD_DESCRIBE
+
+struct hmc_cmd_table {
+  struct hmc_cmd_desc cmd[HMC_CMD_TABLE_SIZE];
+};
+
+// expands hmc_cmd_describe() over [0, HMC_CMD_TABLE_SIZE) at compile time
+template<unsigned... I> struct hmc_cmd_seq {};
+template<unsigned N, unsigned... I> struct hmc_cmd_gen : hmc_cmd_gen<N - 1, N - 1, I...> {};
+template<unsigned... I> struct hmc_cmd_gen<0, I...> {
+  typedef hmc_cmd_seq<I...> type;
+};
+
+template<unsigned... I>
+constexpr struct hmc_cmd_table hmc_cmd_make(hmc_cmd_seq<I...>)
+{
+  return hmc_cmd_table{ { hmc_cmd_describe(I)... } };
+}
+
+// constant initialized, one instance for all vaults
+extern const struct hmc_cmd_table hmc_cmds;
+
+ALWAYS_INLINE const struct hmc_cmd_desc* hmc_cmd_get(unsigned cmd)
+{
+  return &hmc_cmds.cmd[cmd & (HMC_CMD_TABLE_SIZE - 1)];
+}
+
+#endif /* #ifndef _HMC_CMD_H_ */
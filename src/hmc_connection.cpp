@@ -5,6 +5,7 @@
 #include "hmc_link_queue.h"
 #include "hmc_connection.h"
 #include "hmc_packet.h"
+#include "hmc_pool.h"
 #include "hmc_notify.h"
 #include "hmc_macros.h"
 #include "hmc_decode.h"
@@ -19,6 +20,9 @@ hmc_conn_part::hmc_conn_part(unsigned id, hmc_notify *notify, hmc_cube *cub) :
   linkrxbuf_notify(id, notify, this),
   roundRobinSchedule(0x0),
   cyclesBlocked(0x0)
+#ifdef HMC_USES_COUNTERS
+  , counters(HMC_CTR_CONN_NUM)
+#endif /* #ifdef HMC_USES_COUNTERS */
 {
   for (unsigned i = 0; i < HMC_JTL_ALL_LINKS; i++)
     this->links[i] = nullptr;
@@ -38,41 +42,63 @@ bool hmc_conn_part::_set_link(unsigned notifyid, unsigned id, hmc_link *link)
   return false;
 }
 
-unsigned hmc_conn_part::decode_link_of_packet(char *packet)
+void hmc_conn_part::update_routing(unsigned numcubes)
 {
-  uint64_t header = HMC_PACKET_HEADER(packet);
-  unsigned p_cubId, cubId = this->cub->get_id();
-  if (HMCSIM_PACKET_IS_RESPONSE(header)) {
-    unsigned slid = (unsigned)HMCSIM_PACKET_RESPONSE_GET_SLID(header);
-    p_cubId = this->cub->slid_to_cubid(slid);
-    if (p_cubId == cubId) {
-      unsigned p_quadId = this->cub->slid_to_quadid(slid);
-      if (p_quadId == this->id)
-        return HMC_JTL_EXT_LINK(0);
-      else
-        return HMC_JTL_RING_LINK(this->routing(p_quadId));
+  unsigned cubId = this->cub->get_id();
+  this->route_tbl.assign(numcubes * HMC_NUM_QUADS, HMC_JTL_NO_ROUTE);
+  for (unsigned p_cubId = 0; p_cubId < numcubes; p_cubId++) {
+    unsigned ext_id = HMC_JTL_NO_ROUTE;
+    if (p_cubId != cubId && this->cub->get_multipath() != HMC_MULTIPATH_FIRST
+        && __builtin_popcount(this->cub->get_exits(p_cubId)) > 1) {
+      ext_id = HMC_JTL_MULTIPATH;
     }
-  }
-  else {
-    p_cubId = (unsigned)HMCSIM_PACKET_REQUEST_GET_CUB(header);
-    if (p_cubId == cubId) {
-      uint64_t addr = HMCSIM_PACKET_REQUEST_GET_ADRS(header);
-      unsigned p_quadId = (unsigned)this->cub->HMCSIM_UTIL_DECODE_QUAD(addr);
-      if (p_quadId == this->id) {
-        unsigned p_vaultId = (unsigned)this->cub->HMCSIM_UTIL_DECODE_VAULT(addr);
-        return HMC_JTL_VAULT_LINK(p_vaultId);
+    else if (p_cubId != cubId && this->cub->get_routingtbl()[p_cubId] != nullptr) {
+      ext_id = this->cub->ext_routing(p_cubId, this->id);
+      // because the ext routing, does not now the ring routing .. handle it here ...
+      if (HMC_JTL_RING_LINK(0) <= ext_id && ext_id < HMC_JTL_RING_LINK(HMC_NUM_QUADS)) {
+        // extract id -> set routing of ring -> insert id
+        ext_id = HMC_JTL_RING_LINK(this->routing(ext_id - HMC_JTL_RING_LINK(0)));
       }
-      else
-        return HMC_JTL_RING_LINK(this->routing(p_quadId));
+    }
+
+    for (unsigned p_quadId = 0; p_quadId < HMC_NUM_QUADS; p_quadId++) {
+      unsigned linkId = ext_id;
+      if (p_cubId == cubId)
+        linkId = (p_quadId == this->id) ? HMC_JTL_LOCAL : HMC_JTL_RING_LINK(this->routing(p_quadId));
+      this->route_tbl[p_cubId * HMC_NUM_QUADS + p_quadId] = linkId;
     }
   }
-  unsigned ext_id = this->cub->ext_routing(p_cubId, this->id);
-  // because the ext routing, does not now the ring routing .. handle it here ...
-  if (HMC_JTL_RING_LINK(0) <= ext_id && ext_id < HMC_JTL_RING_LINK(HMC_NUM_QUADS)) {
-    // extract id -> set routing of ring -> insert id
-    ext_id = HMC_JTL_RING_LINK(this->routing(ext_id - HMC_JTL_RING_LINK(0)));
+}
+
+unsigned hmc_conn_part::decode_link_of_packet(char *packet, bool peek)
+{
+  struct hmc_packet_meta *meta = hmc_pool::meta(packet);
+  unsigned idx = meta->cub * HMC_NUM_QUADS + meta->quad;
+  assert(idx < this->route_tbl.size());
+  unsigned linkId = this->route_tbl[idx];
+  if (linkId < HMC_JTL_ALL_LINKS)
+    return linkId;
+
+  if (linkId == HMC_JTL_MULTIPATH) {
+    // chosen once per cube, by the first quad routing it
+    unsigned cubId = this->cub->get_id();
+    if (meta->exit_cub != cubId) {
+      if (peek)
+        return HMC_JTL_MULTIPATH;
+      meta->exit_quad = this->cub->multipath_exit(packet, meta->cub);
+      meta->exit_cub = cubId;
+    }
+    if (meta->exit_quad == this->id)
+      return HMC_JTL_EXT_LINK(0);
+    else
+      return HMC_JTL_RING_LINK(this->routing(meta->exit_quad));
   }
-  return ext_id;
+
+  assert(linkId == HMC_JTL_LOCAL); // should really not happen!
+  if (HMCSIM_PACKET_IS_RESPONSE(HMC_PACKET_HEADER(packet)))
+    return HMC_JTL_EXT_LINK(0);
+  else
+    return HMC_JTL_VAULT_LINK(meta->vault);
 }
 
 void hmc_conn_part::clock(void)
@@ -82,6 +108,13 @@ void hmc_conn_part::clock(void)
     if (this->links[i] != nullptr)
       this->links[i]->clock();
   }
+#ifdef HMC_USES_COUNTERS
+  unsigned ready = 0;
+  for (unsigned i = 0; i < HMC_JTL_ALL_LINKS; i++) {
+    if (this->links[i] != nullptr && !this->links[i]->get_rx_fifo_out()->empty())
+      ready++;
+  }
+#endif /* #ifdef HMC_USES_COUNTERS */
 
   unsigned i = this->roundRobinSchedule;
   if (this->links[i] != nullptr) {
@@ -89,21 +122,33 @@ void hmc_conn_part::clock(void)
     unsigned packetleninbit;
     char *packet = rx->front(&packetleninbit);
     if (packet != nullptr) {
+#ifdef HMC_USES_COUNTERS
+      ready--;
+#endif /* #ifdef HMC_USES_COUNTERS */
       unsigned linkId = this->decode_link_of_packet(packet);
       hmc_link *next_link = this->links[linkId];
       assert(next_link != nullptr);
       hmc_link_queue *tx = next_link->get_tx();
       assert(tx != nullptr);
-      if (tx->push_back(packet, packetleninbit))
+      if (tx->push_back(packet, packetleninbit)) {
         rx->pop_front();
+        hmc_pool::meta(packet)->hops++;
+#ifdef HMC_USES_COUNTERS
+        this->counters.inc(HMC_CTR_CONN_ROUTED);
+#endif /* #ifdef HMC_USES_COUNTERS */
+      }
+#ifdef HMC_USES_COUNTERS
+      else
+        this->counters.inc(HMC_CTR_CONN_STALLS);
+#endif /* #ifdef HMC_USES_COUNTERS */
     }
   }
+#ifdef HMC_USES_COUNTERS
+  this->counters.inc(HMC_CTR_CONN_ARB_LOSSES, ready);
+#endif /* #ifdef HMC_USES_COUNTERS */
 #else
-  unsigned notifymap = this->links_notify.get_notification();
-  for (unsigned i, lid = i = __builtin_ctzl(notifymap);
-       notifymap >>= lid;
-       lid = __builtin_ctzl(notifymap >>= 1),
-       i += (lid + 1)) {
+  hmc_notify_map notifymap = this->links_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1)) {
     this->links[i]->clock();
   }
 
@@ -112,19 +157,13 @@ void hmc_conn_part::clock(void)
 //    return;
 //  }
 
-  notifymap = this->linkrxbuf_notify.get_notification();
   // round robin ...
-  unsigned notifymap_p0 = notifymap >> this->roundRobinSchedule;
-  unsigned notifymap_p1 = notifymap & ((0x1 << this->roundRobinSchedule) - 1);
-  notifymap = (notifymap_p1 << (HMC_JTL_ALL_LINKS - this->roundRobinSchedule)) | notifymap_p0;
-
-  unsigned i = __builtin_ctzl(notifymap);
-  if (notifymap >>= i) {
-    // round robin ...
-    if ((i += this->roundRobinSchedule) >= HMC_JTL_ALL_LINKS)
-      i -= HMC_JTL_ALL_LINKS;
-
+  unsigned i = this->linkrxbuf_notify.get_notification().next_wrap(this->roundRobinSchedule);
+  if (i != HMC_NOTIFY_NONE) {
     this->roundRobinSchedule = i;   // last one scheduled will be saved ..
+#ifdef HMC_USES_COUNTERS
+    this->counters.inc(HMC_CTR_CONN_ARB_LOSSES, this->linkrxbuf_notify.get_notification().count() - 1);
+#endif /* #ifdef HMC_USES_COUNTERS */
 
     hmc_link_fifo *rx = this->links[i]->get_rx_fifo_out();
     unsigned packetleninbit;
@@ -138,14 +177,126 @@ void hmc_conn_part::clock(void)
     assert(tx != nullptr);
     if (tx->push_back(packet, packetleninbit)) {
       rx->pop_front();
+      hmc_pool::meta(packet)->hops++;
 //      this->cyclesBlocked = packetleninbit / 384;
+#ifdef HMC_USES_COUNTERS
+      this->counters.inc(HMC_CTR_CONN_ROUTED);
+#endif /* #ifdef HMC_USES_COUNTERS */
     }
+#ifdef HMC_USES_COUNTERS
+    else
+      this->counters.inc(HMC_CTR_CONN_STALLS);
+#endif /* #ifdef HMC_USES_COUNTERS */
   }
 #endif /* #ifndef HMC_USES_NOTIFY */
 
   if (++this->roundRobinSchedule >= HMC_JTL_ALL_LINKS)
     this->roundRobinSchedule = 0x0;
 }
+uint64_t hmc_conn_part::next_event(void)
+{
+  uint64_t next = HMC_NO_EVENT;
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->links_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_JTL_ALL_LINKS; i++)
+    if (this->links[i] != nullptr)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    uint64_t ev = this->links[i]->next_event();
+    if (ev < next)
+      next = ev;
+    if (next == 1)
+      return next;
+  }
+
+  // a packet in a fifo is routed as soon as its next link has space, till then the round robin just moves on
+#ifdef HMC_USES_NOTIFY
+  notifymap = this->linkrxbuf_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_JTL_ALL_LINKS; i++)
+    if (this->links[i] != nullptr && !this->links[i]->get_rx_fifo_out()->empty())
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    unsigned packetleninbit;
+    char *packet = this->links[i]->get_rx_fifo_out()->front(&packetleninbit);
+    unsigned linkId = this->decode_link_of_packet(packet, true);
+    if (linkId == HMC_JTL_MULTIPATH)
+      return 1; // its link is chosen, as soon as it gets scheduled
+    hmc_link *next_link = this->links[linkId];
+    assert(next_link != nullptr);
+    uint64_t ev = next_link->get_tx()->space_event();
+    if (ev < next)
+      next = ev;
+    if (next == 1)
+      return next;
+  }
+  return next;
+}
+
+// replays what clock() does within cycles, in which no packet gets routed
+void hmc_conn_part::fast_forward(uint64_t cycles)
+{
+  if (!cycles)
+    return;
+
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->links_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_JTL_ALL_LINKS; i++)
+    if (this->links[i] != nullptr)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->links[i]->fast_forward(cycles);
+  }
+
+#ifdef HMC_USES_NOTIFY
+  if (!this->links_notify.get_notification()
+      && !this->linkrxbuf_notify.get_notification())
+    return; // would not have been clocked
+
+  notifymap = this->linkrxbuf_notify.get_notification();
+  if (notifymap) {
+#ifdef HMC_USES_COUNTERS
+    // each skipped cycle one blocked packet got scheduled, in the order of the round robin
+    unsigned count = notifymap.count();
+    unsigned i = notifymap.next_wrap(this->roundRobinSchedule);
+    for (unsigned k = 0; k < count; k++) {
+      this->count_blocked(i, cycles / count + (k < cycles % count));
+      i = (i + 1 < HMC_JTL_ALL_LINKS) ? notifymap.next_wrap(i + 1) : notifymap.first();
+    }
+    this->counters.inc(HMC_CTR_CONN_ARB_LOSSES, cycles * (count - 1));
+#endif /* #ifdef HMC_USES_COUNTERS */
+    // the round robin jumps from one blocked fifo to the next, that repeats every count() cycles
+    unsigned steps = (cycles - 1) % notifymap.count() + 1;
+    while (steps--) {
+      unsigned i = notifymap.next_wrap(this->roundRobinSchedule);
+      if (++i >= HMC_JTL_ALL_LINKS)
+        i = 0x0;
+      this->roundRobinSchedule = i;
+    }
+    return;
+  }
+#endif /* #ifdef HMC_USES_NOTIFY */
+#if defined(HMC_USES_COUNTERS) && !defined(HMC_USES_NOTIFY)
+  // the round robin passes each slot cycles / HMC_JTL_ALL_LINKS times (+1 for the first few), a packet waiting there is blocked
+  uint64_t rounds = cycles / HMC_JTL_ALL_LINKS;
+  unsigned rest = cycles % HMC_JTL_ALL_LINKS;
+  for (unsigned i = 0; i < HMC_JTL_ALL_LINKS; i++) {
+    if (this->links[i] == nullptr || this->links[i]->get_rx_fifo_out()->empty())
+      continue;
+    unsigned dist = (i + HMC_JTL_ALL_LINKS - this->roundRobinSchedule) % HMC_JTL_ALL_LINKS;
+    uint64_t hits = rounds + (dist < rest);
+    this->count_blocked(i, hits);
+    this->counters.inc(HMC_CTR_CONN_ARB_LOSSES, cycles - hits);
+  }
+#endif /* #if defined(HMC_USES_COUNTERS) && !defined(HMC_USES_NOTIFY) */
+  this->roundRobinSchedule = (this->roundRobinSchedule + cycles % HMC_JTL_ALL_LINKS) % HMC_JTL_ALL_LINKS;
+}
+
 bool hmc_conn_part::notify_up(unsigned id)
 {
 #ifdef HMC_USES_NOTIFY
@@ -156,14 +307,41 @@ bool hmc_conn_part::notify_up(unsigned id)
 #endif /* #ifdef HMC_USES_NOTIFY */
 }
 
+#ifdef HMC_USES_COUNTERS
+// the packet at links[i] was refused hits times by its next link
+void hmc_conn_part::count_blocked(unsigned i, uint64_t hits)
+{
+  if (!hits)
+    return;
+  unsigned packetleninbit;
+  char *packet = this->links[i]->get_rx_fifo_out()->front(&packetleninbit);
+  this->counters.inc(HMC_CTR_CONN_STALLS, hits);
+  unsigned linkId = this->decode_link_of_packet(packet, true);
+  assert(linkId < HMC_JTL_ALL_LINKS); // blocked -> its link was chosen
+  this->links[linkId]->get_tx()->count_stalls(hits);
+}
+
+void hmc_conn_part::collect_counters(hmc_counters *ctrs, const std::string &prefix)
+{
+  ctrs->add(prefix, &this->counters, hmc_conn_counter_names);
+  for (unsigned i = 0; i < HMC_JTL_ALL_LINKS; i++) {
+    if (this->links[i] == nullptr)
+      continue;
+    if (i < HMC_JTL_RING_LINK(0))
+      this->links[i]->collect_counters(ctrs, prefix + ".ext" + std::to_string(i));
+    else if (i < HMC_JTL_VAULT_LINK(0))
+      this->links[i]->collect_counters(ctrs, prefix + ".ring" + std::to_string(i - HMC_JTL_RING_LINK(0)));
+    else
+      this->links[i]->collect_counters(ctrs, prefix + ".vault" + std::to_string(i - HMC_JTL_VAULT_LINK(0)));
+  }
+}
+#endif /* #ifdef HMC_USES_COUNTERS */
+
 void hmc_conn::clock(void)
 {
 #ifdef HMC_USES_NOTIFY
-  unsigned notifymap = this->conn_notify.get_notification();
-  for (unsigned i, lid = i = __builtin_ctzl(notifymap);
-       notifymap >>= lid;
-       lid = __builtin_ctzl(notifymap >>= 1),
-       i += (lid + 1))
+  hmc_notify_map notifymap = this->conn_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
 #else
   for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
 #endif /* #ifdef HMC_USES_NOTIFY */
@@ -172,6 +350,38 @@ void hmc_conn::clock(void)
   }
 }
 
+uint64_t hmc_conn::next_event(void)
+{
+  uint64_t next = HMC_NO_EVENT;
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->conn_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    uint64_t ev = this->conns[i]->next_event();
+    if (ev < next)
+      next = ev;
+    if (next == 1)
+      return next;
+  }
+  return next;
+}
+
+void hmc_conn::fast_forward(uint64_t cycles)
+{
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->conn_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->conns[i]->fast_forward(cycles);
+  }
+}
+
 bool hmc_conn::notify_up(unsigned id)
 {
 #ifdef HMC_USES_NOTIFY
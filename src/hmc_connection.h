@@ -2,10 +2,19 @@
 #define _HMC_CONNECTION_H_
 
 #include <array>
+#include <cstdint>
+#include <list>
+#include <vector>
+#ifdef HMC_USES_COUNTERS
+# include <string>
+#endif /* #ifdef HMC_USES_COUNTERS */
 #include "config.h"
 #include "hmc_notify.h"
 #include "hmc_macros.h"
 #include "hmc_module.h"
+#ifdef HMC_USES_COUNTERS
+# include "hmc_counters.h"
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 class hmc_cube;
 class hmc_quad;
@@ -15,6 +24,13 @@ class hmc_link;
 #define HMC_JTL_EXT_LINK( x )     ( x )
 #define HMC_JTL_RING_LINK( x )    ( HMC_MAX_LINKS/HMC_NUM_QUADS + (x) )
 #define HMC_JTL_VAULT_LINK( x )   ( HMC_MAX_LINKS/HMC_NUM_QUADS + HMC_NUM_QUADS + (x) )
+// entries of the routing lookup, besides links
+#define HMC_JTL_LOCAL             ( HMC_JTL_ALL_LINKS )       // destined to this quad: vault or slid
+#define HMC_JTL_NO_ROUTE          ( HMC_JTL_ALL_LINKS + 1 )
+#define HMC_JTL_MULTIPATH         ( HMC_JTL_ALL_LINKS + 2 )   // another cube, over one of several links (hmc_cube::multipath_exit())
+
+static_assert(HMC_JTL_ALL_LINKS <= HMC_NOTIFY_MAX_CHILDREN, "HMC_JTL_ALL_LINKS exceeds HMC_NOTIFY_MAX_CHILDREN");
+static_assert(HMC_JTL_MULTIPATH <= UINT8_MAX, "HMC_JTL_MULTIPATH exceeds the routing lookup's entries");
 
 class hmc_conn_part : private hmc_notify_cl, public hmc_module {
 protected:
@@ -28,8 +44,16 @@ private:
   std::array<hmc_link*, HMC_JTL_ALL_LINKS> links;
   unsigned roundRobinSchedule;
   unsigned cyclesBlocked;
+  // next link by destination (cube * HMC_NUM_QUADS + quad), see update_routing()
+  std::vector<uint8_t> route_tbl;
+#ifdef HMC_USES_COUNTERS
+  hmc_counter_block counters;
+
+  void count_blocked(unsigned i, uint64_t hits);
+#endif /* #ifdef HMC_USES_COUNTERS */
 
-  unsigned decode_link_of_packet(char* packet);
+  // peek: don't make a multipath choice, HMC_JTL_MULTIPATH if there is none yet
+  unsigned decode_link_of_packet(char* packet, bool peek = false);
   bool _set_link(unsigned notifyid, unsigned id, hmc_link *link);
 
   virtual unsigned routing(unsigned nextquad) = 0;
@@ -55,8 +79,21 @@ public:
     return false;
   }
 
+  // flattens ring and external routing, has to follow every change of the cube's routing tables
+  void update_routing(unsigned numcubes);
+
   void clock(void);
+  uint64_t next_event(void);
+  void fast_forward(uint64_t cycles);
   unsigned get_id(void) { return this->id; }
+  ALWAYS_INLINE hmc_link* get_link(unsigned i)
+  {
+    return this->links[i];
+  }
+
+#ifdef HMC_USES_COUNTERS
+  void collect_counters(hmc_counters *ctrs, const std::string &prefix);
+#endif /* #ifdef HMC_USES_COUNTERS */
 };
 
 class hmc_conn : public hmc_notify_cl {
@@ -82,6 +119,8 @@ public:
   }
 
   void clock(void);
+  uint64_t next_event(void);
+  void fast_forward(uint64_t cycles);
 };
 
 #endif /* #ifndef _HMC_CONNECTION_H_ */
@@ -0,0 +1,103 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "hmc_counters.h"
+
+const char *const hmc_queue_counter_names[HMC_CTR_QUEUE_NUM] = {
+  "packets", "flits", "stalls", "busy"
+};
+const char *const hmc_fifo_counter_names[HMC_CTR_FIFO_NUM] = {
+  "packets", "occupancy", "max"
+};
+const char *const hmc_conn_counter_names[HMC_CTR_CONN_NUM] = {
+  "routed", "stalls", "arb_losses"
+};
+const char *const hmc_vault_counter_names[HMC_CTR_VAULT_NUM] = {
+  "rqsts", "reads", "writes", "logic", "errors", "stalls"
+};
+
+hmc_counter_block::hmc_counter_block(unsigned n) :
+  n(n)
+{
+  size_t bytes = ((n * sizeof(uint64_t) + HMC_COUNTERS_LINE - 1) / HMC_COUNTERS_LINE) * HMC_COUNTERS_LINE;
+  void *mem;
+  if (posix_memalign(&mem, HMC_COUNTERS_LINE, bytes)) {
+    std::cerr << "ERROR: couldn't allocate counters!" << std::endl;
+    exit(-1);
+  }
+  this->v = (uint64_t*)mem;
+  memset(this->v, 0, bytes);
+}
+
+hmc_counter_block::~hmc_counter_block(void)
+{
+  free(this->v);
+}
+
+void hmc_counter_block::reset(void)
+{
+  memset(this->v, 0, this->n * sizeof(uint64_t));
+}
+
+void hmc_counters::clear(void)
+{
+  this->blocks.clear();
+  this->index.clear();
+}
+
+void hmc_counters::add(const std::string &prefix, const hmc_counter_block *blk, const char *const *names)
+{
+  struct entry e = { prefix, blk, names };
+  unsigned b = this->blocks.size();
+  this->blocks.push_back(e);
+  for (unsigned i = 0; i < blk->size(); i++)
+    this->index.push_back(std::make_pair(b, i));
+}
+
+std::string hmc_counters::name(unsigned i)
+{
+  const struct entry *e = &this->blocks[this->index[i].first];
+  return e->prefix + "." + e->names[this->index[i].second];
+}
+
+uint64_t hmc_counters::value(unsigned i)
+{
+  return this->blocks[this->index[i].first].blk->get(this->index[i].second);
+}
+
+bool hmc_counters::get(const std::string &name, uint64_t *value)
+{
+  size_t dot = name.rfind('.');
+  if (dot == std::string::npos)
+    return false;
+
+  for (auto it = this->blocks.begin(); it != this->blocks.end(); ++it) {
+    if (name.compare(0, dot, it->prefix))
+      continue;
+    for (unsigned i = 0; i < it->blk->size(); i++) {
+      if (!name.compare(dot + 1, std::string::npos, it->names[i])) {
+        *value = it->blk->get(i);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void hmc_counters::dump_csv(std::ostream &os, uint64_t cycle, bool header)
+{
+  if (header)
+    os << "cycle,name,value\n";
+  for (unsigned i = 0; i < this->size(); i++)
+    os << cycle << "," << this->name(i) << "," << this->value(i) << "\n";
+  os.flush();
+}
+
+void hmc_counters::dump_json(std::ostream &os, uint64_t cycle)
+{
+  os << "{\"cycle\": " << cycle << ", \"counters\": {";
+  for (unsigned i = 0; i < this->size(); i++)
+    os << (i ? ", " : "") << "\"" << this->name(i) << "\": " << this->value(i);
+  os << "}}\n";
+  os.flush();
+}
@@ -0,0 +1,127 @@
+#ifndef _HMC_COUNTERS_H_
+#define _HMC_COUNTERS_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "hmc_macros.h"
+
+/*
+ * Event counters (HMC_USES_COUNTERS). Every module keeps its own block of
+ * counters, which is placed in cache lines of its own: modules clocked by
+ * different threads never share one. The modules only count, hmc_sim collects
+ * the blocks by name (hmc_counters) whenever they are queried or dumped.
+ */
+#define HMC_COUNTERS_LINE   64
+
+class hmc_counter_block {
+private:
+  uint64_t *v;
+  unsigned n;
+
+  hmc_counter_block(const hmc_counter_block&);
+  hmc_counter_block& operator=(const hmc_counter_block&);
+
+public:
+  explicit hmc_counter_block(unsigned n);
+  ~hmc_counter_block(void);
+
+  ALWAYS_INLINE void inc(unsigned i, uint64_t by = 1)
+  {
+    this->v[i] += by;
+  }
+  ALWAYS_INLINE void max(unsigned i, uint64_t val)
+  {
+    if (val > this->v[i])
+      this->v[i] = val;
+  }
+  ALWAYS_INLINE uint64_t get(unsigned i) const
+  {
+    return this->v[i];
+  }
+  ALWAYS_INLINE unsigned size(void) const
+  {
+    return this->n;
+  }
+  void reset(void);
+};
+
+// hmc_link_queue: the transmitting side of a link, as seen by its receiver
+enum hmc_queue_counter {
+  HMC_CTR_QUEUE_PACKETS,      // accepted by push_back()
+  HMC_CTR_QUEUE_FLITS,
+  HMC_CTR_QUEUE_STALLS,       // push_back() refused, link full
+  HMC_CTR_QUEUE_BUSY,         // cycles transmitting -> utilisation: busy / cycles
+  HMC_CTR_QUEUE_NUM
+};
+
+// hmc_link_fifo: the receive buffer of a link
+enum hmc_fifo_counter {
+  HMC_CTR_FIFO_PACKETS,
+  HMC_CTR_FIFO_OCCUPANCY,     // sum of the packets found on arrival -> avg.: occupancy / packets
+  HMC_CTR_FIFO_MAX,           // max. packets held
+  HMC_CTR_FIFO_NUM
+};
+
+// hmc_conn_part: the switch of a quad
+enum hmc_conn_counter {
+  HMC_CTR_CONN_ROUTED,
+  HMC_CTR_CONN_STALLS,        // scheduled packet blocked by its next link
+  HMC_CTR_CONN_ARB_LOSSES,    // ready packets, which were not scheduled
+  HMC_CTR_CONN_NUM
+};
+
+// hmc_vault, reads / writes / logic in the order of enum hmc_cmd_kind
+enum hmc_vault_counter {
+  HMC_CTR_VAULT_RQSTS,
+  HMC_CTR_VAULT_READS,
+  HMC_CTR_VAULT_WRITES,
+  HMC_CTR_VAULT_LOGIC,
+  HMC_CTR_VAULT_ERRORS,
+  HMC_CTR_VAULT_STALLS,       // no space for the response
+  HMC_CTR_VAULT_NUM
+};
+
+extern const char *const hmc_queue_counter_names[HMC_CTR_QUEUE_NUM];
+extern const char *const hmc_fifo_counter_names[HMC_CTR_FIFO_NUM];
+extern const char *const hmc_conn_counter_names[HMC_CTR_CONN_NUM];
+extern const char *const hmc_vault_counter_names[HMC_CTR_VAULT_NUM];
+
+/*
+ * Flat, named view onto the blocks: "<module path>.<counter>", e.g.
+ * cube0.quad1.vault2.link.q.stalls. Values are read when asked for, the view
+ * stays valid as long as the modules live.
+ */
+class hmc_counters {
+private:
+  struct entry {
+    std::string prefix;
+    const hmc_counter_block *blk;
+    const char *const *names;
+  };
+  std::vector<struct entry> blocks;
+  std::vector<std::pair<unsigned, unsigned> > index;   // counter -> (block, idx)
+
+public:
+  hmc_counters(void) {}
+  ~hmc_counters(void) {}
+
+  void clear(void);
+  void add(const std::string &prefix, const hmc_counter_block *blk, const char *const *names);
+
+  ALWAYS_INLINE unsigned size(void)
+  {
+    return this->index.size();
+  }
+  std::string name(unsigned i);
+  uint64_t value(unsigned i);
+  bool get(const std::string &name, uint64_t *value);
+
+  // CSV: one "cycle,name,value" line per counter, JSON: one object per snapshot and line
+  void dump_csv(std::ostream &os, uint64_t cycle, bool header);
+  void dump_json(std::ostream &os, uint64_t cycle);
+};
+
+#endif /* #ifndef _HMC_COUNTERS_H_ */
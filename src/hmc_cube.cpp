@@ -5,18 +5,23 @@
 #include "hmc_link.h"
 #include "hmc_conn_ring.h"
 #include "hmc_conn_xbar.h"
+#include "hmc_decode.h"
+#include "hmc_link_queue.h"
 
 hmc_cube::hmc_cube(unsigned id, hmc_notify *notify,
                    unsigned quadbus_bitwidth, float quadbus_bitrate,
                    unsigned capacity,
-                   std::map<unsigned, hmc_cube*> *cubes, unsigned numcubes, uint64_t *clk) :
+                   std::map<unsigned, hmc_cube*> *cubes, unsigned numcubes, uint64_t *clk,
+                   hmc_pool *pool) :
   hmc_route(cubes, numcubes),
   hmc_notify_cl(),
   hmc_register(this, capacity),
   id(id),
+  capacity(capacity),
   quad_notify(id, notify, this),
   conn_notify(id, notify, this),
-  conn(nullptr)
+  conn(nullptr),
+  pool(pool)
 {
   char *quadConnection = getenv("HMCSIM_QUAD_CONNECTION");
   // default is ring to connection quads
@@ -29,9 +34,25 @@ hmc_cube::hmc_cube(unsigned id, hmc_notify *notify,
     exit(-1);
   }
 
+  char *multipath = getenv("HMCSIM_MULTIPATH");
+  if (multipath == nullptr || !strcmp("first", multipath))
+    this->multipath = HMC_MULTIPATH_FIRST;
+  else if (!strcmp("rr", multipath))
+    this->multipath = HMC_MULTIPATH_RR;
+  else if (!strcmp("hash", multipath))
+    this->multipath = HMC_MULTIPATH_HASH;
+  else if (!strcmp("least", multipath))
+    this->multipath = HMC_MULTIPATH_LEAST;
+  else {
+    std::cerr << "ERROR: env HMCSIM_MULTIPATH has wrong value! " << multipath << ", choose first, rr, hash or least" << std::endl;
+    exit(-1);
+  }
+
   unsigned num_ranks = capacity; /* num_ranks 8GB -> 8 layer, 4GB -> 4layer */
   for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
     this->quads[i] = new hmc_quad(i, this->conn->get_conn(i), num_ranks, &this->quad_notify, this, clk);
+
+  this->hmc_routing_flatten();
 }
 
 hmc_cube::~hmc_cube(void)
@@ -41,6 +62,67 @@ hmc_cube::~hmc_cube(void)
   delete this->conn;
 }
 
+void hmc_cube::hmc_routing_flatten(void)
+{
+  for (unsigned d = 0; d < this->get_numcubes(); d++) {
+    unsigned mask = 0x0;
+    for (hmc_route_t *route = this->get_routingtbl()[d]; route != nullptr; route = route->next)
+      mask |= *route->links;
+    this->exits[d] = mask & ((0x1 << HMC_NUM_QUADS) - 1); // Mapping: each quad has its own single link (as of HMC2.1)
+  }
+
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
+    this->conn->get_conn(i)->update_routing(this->get_numcubes());
+}
+
+void hmc_cube::set_multipath(enum hmc_multipath multipath)
+{
+  this->multipath = multipath;
+  this->hmc_routing_flatten();
+}
+
+unsigned hmc_cube::multipath_exit(char *packet, unsigned destCubId)
+{
+  unsigned mask = this->exits[destCubId];
+  assert(mask); // should really not happen!
+
+  unsigned nth = 0;
+  switch (this->multipath) {
+  case HMC_MULTIPATH_RR:
+    nth = this->exits_rr[destCubId]++;
+    break;
+  case HMC_MULTIPATH_HASH:
+  {
+    uint64_t header = HMC_PACKET_HEADER(packet);
+    uint64_t key = HMCSIM_PACKET_IS_REQUEST(header) ? (HMCSIM_PACKET_REQUEST_GET_ADRS(header) >> 4)
+                                                     : HMCSIM_PACKET_RESPONSE_GET_TAG(header);
+    nth = (unsigned)((key * 0x9E3779B97F4A7C15ull) >> 32);
+    break;
+  }
+  case HMC_MULTIPATH_LEAST:
+  {
+    unsigned least = ~0x0, quad = 0;
+    for (unsigned m = mask; m; m &= m - 1) {
+      unsigned q = __builtin_ctz(m);
+      unsigned occ = this->get_conn(q)->get_link(HMC_JTL_EXT_LINK(0))->get_tx()->get_occupation();
+      if (occ < least) {
+        least = occ;
+        quad = q;
+      }
+    }
+    return quad;
+  }
+  case HMC_MULTIPATH_FIRST:
+  default:
+    break;
+  }
+
+  nth %= __builtin_popcount(mask);
+  while (nth--)
+    mask &= mask - 1;
+  return __builtin_ctz(mask);
+}
+
 void hmc_cube::clock(void)
 {
 #ifdef HMC_USES_NOTIFY
@@ -51,11 +133,8 @@ void hmc_cube::clock(void)
   }
 
 #ifdef HMC_USES_NOTIFY
-  unsigned notifymap = this->quad_notify.get_notification();
-  for (unsigned i, lid = i = __builtin_ctzl(notifymap);
-       notifymap >>= lid;
-       lid = __builtin_ctzl(notifymap >>= 1),
-       i += (lid + 1))
+  hmc_notify_map notifymap = this->quad_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
 #else
   for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
 #endif /* #ifdef HMC_USES_NOTIFY */
@@ -64,6 +143,83 @@ void hmc_cube::clock(void)
   }
 }
 
+#ifdef HMC_USES_THREADS
+void hmc_cube::clock_conn(void)
+{
+#ifdef HMC_USES_NOTIFY
+  if (this->conn_notify.get_notification())
+#endif
+  {
+    this->conn->clock();
+  }
+}
+
+void hmc_cube::stage_vaults(std::vector<hmc_vault_task> *tasks)
+{
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->quad_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->quads[i]->stage_vaults(tasks);
+  }
+}
+
+void hmc_cube::commit_vaults(void)
+{
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
+    this->quads[i]->commit_vaults();
+}
+#endif /* #ifdef HMC_USES_THREADS */
+
+uint64_t hmc_cube::next_event(void)
+{
+  uint64_t next = HMC_NO_EVENT;
+#ifdef HMC_USES_NOTIFY
+  if (this->conn_notify.get_notification())
+#endif
+  {
+    next = this->conn->next_event();
+  }
+
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->quad_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    uint64_t ev = this->quads[i]->next_event();
+    if (ev < next)
+      next = ev;
+    if (next == 1)
+      return next;
+  }
+  return next;
+}
+
+void hmc_cube::fast_forward(uint64_t cycles)
+{
+#ifdef HMC_USES_NOTIFY
+  if (this->conn_notify.get_notification())
+#endif
+  {
+    this->conn->fast_forward(cycles);
+  }
+
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->quad_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->quads[i]->fast_forward(cycles);
+  }
+}
+
 bool hmc_cube::notify_up(unsigned id)
 {
 #ifdef HMC_USES_NOTIFY
@@ -73,3 +229,14 @@ bool hmc_cube::notify_up(unsigned id)
   return true;
 #endif /* #ifdef HMC_USES_NOTIFY */
 }
+
+#ifdef HMC_USES_COUNTERS
+void hmc_cube::collect_counters(hmc_counters *ctrs, const std::string &prefix)
+{
+  for (unsigned i = 0; i < HMC_NUM_QUADS; i++) {
+    std::string quad = prefix + ".quad" + std::to_string(i);
+    this->conn->get_conn(i)->collect_counters(ctrs, quad + ".conn");
+    this->quads[i]->collect_counters(ctrs, quad);
+  }
+}
+#endif /* #ifdef HMC_USES_COUNTERS */
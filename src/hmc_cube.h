@@ -2,25 +2,40 @@
 #define _HMC_CUBE_H_
 
 #include <array>
+#ifdef HMC_USES_THREADS
+# include <vector>
+#endif /* #ifdef HMC_USES_THREADS */
+#ifdef HMC_USES_COUNTERS
+# include <string>
+#endif /* #ifdef HMC_USES_COUNTERS */
 #include "hmc_macros.h"
 #include "hmc_route.h"
 #include "hmc_notify.h"
 #include "hmc_register.h"
 #include "hmc_connection.h"
+#ifdef HMC_USES_THREADS
+# include "hmc_quad.h" // hmc_vault_task
+#endif /* #ifdef HMC_USES_THREADS */
 
 class hmc_quad;
 class hmc_link;
+class hmc_pool;
+#ifdef HMC_USES_COUNTERS
+class hmc_counters;
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 class hmc_cube : public hmc_route,
                  private hmc_notify_cl,
                  public hmc_register {
 private:
   unsigned id;
+  unsigned capacity;
 
   hmc_notify quad_notify;
   std::array<hmc_quad*, HMC_NUM_QUADS> quads;
   hmc_notify conn_notify;
   hmc_conn* conn;
+  hmc_pool *pool;
 
   bool notify_up(unsigned id);
 
@@ -28,7 +43,8 @@ public:
   hmc_cube(unsigned id, hmc_notify *notify,
            unsigned quadbus_bitwidth, float quadbus_bitrate,
            unsigned capacity,
-           std::map<unsigned, hmc_cube*>* cubes, unsigned numcubes, uint64_t *clk);
+           std::map<unsigned, hmc_cube*>* cubes, unsigned numcubes, uint64_t *clk,
+           hmc_pool *pool);
   virtual ~hmc_cube(void);
 
   ALWAYS_INLINE unsigned get_id(void)
@@ -36,12 +52,46 @@ public:
     return this->id;
   }
 
+  // in GB
+  ALWAYS_INLINE unsigned get_capacity(void)
+  {
+    return this->capacity;
+  }
+
+  ALWAYS_INLINE hmc_pool* get_pool(void)
+  {
+    return this->pool;
+  }
+
   ALWAYS_INLINE hmc_conn_part* get_conn(unsigned id)
   {
     return this->conn->get_conn(id);
   }
 
+  ALWAYS_INLINE bool get_notification(void)
+  {
+    return this->conn_notify.get_notification() || this->quad_notify.get_notification();
+  }
+
+  // rebuilds the routing lookup of all quads, once the routing tables changed
+  void hmc_routing_flatten(void);
+  void set_multipath(enum hmc_multipath multipath);
+  // quad to leave the cube from, as the packet is headed to another cube over one of several links
+  unsigned multipath_exit(char *packet, unsigned destCubId);
+
   void clock(void);
+  uint64_t next_event(void);
+  void fast_forward(uint64_t cycles);
+#ifdef HMC_USES_COUNTERS
+  void collect_counters(hmc_counters *ctrs, const std::string &prefix);
+#endif /* #ifdef HMC_USES_COUNTERS */
+
+#ifdef HMC_USES_THREADS
+  // clock() split up: the connection first, then the vaults concurrently (see hmc_quad)
+  void clock_conn(void);
+  void stage_vaults(std::vector<hmc_vault_task> *tasks);
+  void commit_vaults(void);
+#endif /* #ifdef HMC_USES_THREADS */
 };
 
 
@@ -131,8 +131,23 @@
 /* ----------------------------------------- */
 
 #define HMC_PACKET_HEADER( x )    (((uint64_t*)(x))[0])
-#define HMC_PACKET_REQ_TAIL( x )  (((uint64_t*)(x))[(HMCSIM_PACKET_REQUEST_GET_LNG(HMC_PACKET_HEADER(x)) << 1)-1])
-#define HMC_PACKET_RESP_TAIL( x ) (((uint64_t*)(x))[(HMCSIM_PACKET_RESPONSE_GET_LNG(HMC_PACKET_HEADER(x)) << 1)-1])
+#ifdef HMC_USES_TIMING_ONLY
+/*
+ * Packets within the simulator are descriptors of a single FLIT: header and
+ * tail, the payload is never stored. LNG still holds the FLITs, which the
+ * links serialize. Packets handed out to the host are complete again.
+ */
+# ifdef HMC_USES_MEM
+#  error "HMC_USES_TIMING_ONLY: there is no payload for HMC_USES_MEM"
+# endif /* #ifdef HMC_USES_MEM */
+#define HMC_PACKET_STORED_FLITS( flits )  1
+#define HMC_PACKET_TAIL_IDX( flits )      1
+#else
+#define HMC_PACKET_STORED_FLITS( flits )  (flits)
+#define HMC_PACKET_TAIL_IDX( flits )      (((flits) << 1) - 1)
+#endif /* #ifdef HMC_USES_TIMING_ONLY */
+#define HMC_PACKET_REQ_TAIL( x )  (((uint64_t*)(x))[HMC_PACKET_TAIL_IDX(HMCSIM_PACKET_REQUEST_GET_LNG(HMC_PACKET_HEADER(x)))])
+#define HMC_PACKET_RESP_TAIL( x ) (((uint64_t*)(x))[HMC_PACKET_TAIL_IDX(HMCSIM_PACKET_RESPONSE_GET_LNG(HMC_PACKET_HEADER(x)))])
 
 /* ----------------------------------------- */
 class hmc_decode {
@@ -0,0 +1,202 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "hmc_host.h"
+#include "hmc_sim.h"
+#include "hmc_cmd.h"
+#include "hmc_decode.h"
+
+hmc_host::hmc_host(hmc_sim *sim, const std::vector<unsigned> &slids, unsigned window) :
+  sim(sim),
+  next(0),
+  outstanding(0)
+{
+  if (slids.empty() || !window || window > HMC_HOST_TAGS) {
+    std::cerr << "ERROR: host needs at least one slid and a window of 1 to " << HMC_HOST_TAGS << "!" << std::endl;
+    exit(-1);
+  }
+
+  unsigned used = 0x0;
+  for (auto it = slids.begin(); it != slids.end(); ++it) {
+    if (*it >= HMC_MAX_SLIDS || (used & (0x1 << *it))) {
+      std::cerr << "ERROR: slid " << *it << " is not valid for the host!" << std::endl;
+      exit(-1);
+    }
+    used |= (0x1 << *it);
+
+    struct hmc_host_slid s;
+    s.id = *it;
+    for (unsigned tag = window; tag-- > 0;)
+      s.free_tags.push_back(tag);
+    s.entries.resize(window);
+    for (unsigned tag = 0; tag < window; tag++)
+      s.entries[tag].busy = false;
+    s.stalled = nullptr;
+    s.stalled_tag = 0;
+    s.sent = 0;
+    s.received = 0;
+    s.stalls = 0;
+    this->slids.push_back(s);
+  }
+}
+
+hmc_host::~hmc_host(void)
+{
+  for (auto it = this->slids.begin(); it != this->slids.end(); ++it) {
+    if (it->stalled != nullptr)
+      this->sim->hmc_release_pkt(it->stalled);
+  }
+}
+
+bool hmc_host::send(struct hmc_host_slid *s, uint16_t tag, char *packet)
+{
+  if (!this->sim->hmc_send_pkt_owned(s->id, packet))
+    return false;
+
+  struct hmc_host_entry *e = &s->entries[tag];
+  e->sent = this->sim->hmc_get_clock();
+  s->sent++;
+  if (!hmc_cmd_get(e->rqst.cmd)->rsp)
+    this->complete(s, tag, nullptr);
+  return true;
+}
+
+void hmc_host::complete(struct hmc_host_slid *s, uint16_t tag, char *packet)
+{
+  struct hmc_host_entry *e = &s->entries[tag];
+  if (this->cb) {
+    struct hmc_host_cpl cpl;
+    cpl.slid = s->id;
+    cpl.tag = tag;
+    cpl.rqst = e->rqst;
+    cpl.sent = e->sent;
+    cpl.latency = this->sim->hmc_get_clock() - e->sent;
+    cpl.packet = packet;
+    this->cb(&cpl);
+  }
+  e->busy = false;
+  s->free_tags.push_back(tag);
+  this->outstanding--;
+}
+
+bool hmc_host::can_issue(void)
+{
+  for (auto it = this->slids.begin(); it != this->slids.end(); ++it) {
+    if (it->stalled == nullptr && !it->free_tags.empty())
+      return true;
+  }
+  return false;
+}
+
+bool hmc_host::issue(const struct hmc_host_rqst *rqst)
+{
+  unsigned n = this->slids.size();
+  for (unsigned i = 0; i < n; i++) {
+    struct hmc_host_slid *s = &this->slids[this->next];
+    if (++this->next >= n)
+      this->next = 0;
+    if (s->stalled != nullptr || s->free_tags.empty())
+      continue;
+
+    unsigned flits = hmc_cmd_get(rqst->cmd)->rqst_flits;
+    if (!flits) {
+      // ToDo: CMC!
+      std::cerr << "ERROR: host can't encode command " << rqst->cmd << "!" << std::endl;
+      throw false;
+    }
+    uint16_t tag = s->free_tags.back();
+    s->free_tags.pop_back();
+    s->entries[tag].rqst = *rqst;
+    s->entries[tag].busy = true;
+    this->outstanding++;
+
+    char *packet = this->sim->hmc_alloc_pkt(flits);
+    this->sim->hmc_encode_pkt(rqst->cube, rqst->addr, tag, rqst->cmd, packet);
+    if (!this->send(s, tag, packet)) {
+      s->stalled = packet;
+      s->stalled_tag = tag;
+    }
+    return true;
+  }
+  return false;
+}
+
+void hmc_host::poll(void)
+{
+  for (auto it = this->slids.begin(); it != this->slids.end(); ++it) {
+    struct hmc_host_slid *s = &*it;
+    if (s->stalled != nullptr) {
+      if (this->send(s, s->stalled_tag, s->stalled))
+        s->stalled = nullptr;
+      else
+        s->stalls++;
+    }
+
+    char *rsp;
+    while ((rsp = this->sim->hmc_recv_pkt_view(s->id)) != nullptr) {
+      unsigned tag = HMCSIM_PACKET_RESPONSE_GET_TAG(HMC_PACKET_HEADER(rsp));
+      if (tag < s->entries.size() && s->entries[tag].busy) {
+        s->received++;
+        this->complete(s, tag, rsp);
+      }
+      else
+        std::cerr << "ERROR: response of slid " << s->id << " with tag " << tag << " was not requested!" << std::endl;
+      this->sim->hmc_release_pkt(rsp);
+    }
+  }
+}
+
+uint64_t hmc_host::run(const hmc_host_gen &gen, bool skip)
+{
+  uint64_t start = this->sim->hmc_get_clock();
+  uint64_t n = 0;
+  bool more = true;
+  struct hmc_host_rqst rqst;
+
+  do {
+    this->poll();
+    while (more && this->can_issue()) {
+      memset(&rqst, 0, sizeof(rqst));
+      if (!gen(n, &rqst)) {
+        more = false;
+        break;
+      }
+      this->issue(&rqst);
+      n++;
+    }
+    if (!more && !this->outstanding)
+      break;
+
+    // the host only waits for responses or space on its slids
+    if (skip && !(more && this->can_issue()))
+      this->sim->clock_skip(0x100000);
+    else
+      this->sim->clock();
+  } while (true);
+
+  return this->sim->hmc_get_clock() - start;
+}
+
+uint64_t hmc_host::get_sent(void)
+{
+  uint64_t sum = 0;
+  for (auto it = this->slids.begin(); it != this->slids.end(); ++it)
+    sum += it->sent;
+  return sum;
+}
+
+uint64_t hmc_host::get_received(void)
+{
+  uint64_t sum = 0;
+  for (auto it = this->slids.begin(); it != this->slids.end(); ++it)
+    sum += it->received;
+  return sum;
+}
+
+uint64_t hmc_host::get_stalls(void)
+{
+  uint64_t sum = 0;
+  for (auto it = this->slids.begin(); it != this->slids.end(); ++it)
+    sum += it->stalls;
+  return sum;
+}
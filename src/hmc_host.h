@@ -0,0 +1,105 @@
+#ifndef _HMC_HOST_H_
+#define _HMC_HOST_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "config.h"
+#include "hmc_macros.h"
+#include "hmc_sim_t.h"
+
+class hmc_sim;
+
+/*
+ * Host side traffic injector. Requests are spread round robin over the given
+ * slids, each of them keeps its own pool of the 11 bit tags and a window of
+ * outstanding requests. A request refused by its slid (link full) stays with
+ * the slid and is retried every cycle, before the slid takes anything new.
+ * Responses are matched to their request by slid and tag, therewith they may
+ * return in any order. Posted requests (no response) complete once sent.
+ *
+ * Packets are built within the simulator's pool and received in place (see
+ * hmc_send_pkt_owned(), hmc_recv_pkt_view()).
+ */
+#define HMC_HOST_TAGS   0x800   // 11 bit tag
+
+struct hmc_host_rqst {
+  unsigned cube;
+  uint64_t addr;
+  hmc_rqst_t cmd;
+  void *cookie;         // handed back by the completion
+};
+
+struct hmc_host_cpl {
+  unsigned slid;
+  uint16_t tag;
+  struct hmc_host_rqst rqst;
+  uint64_t sent;        // cycle the slid took the request
+  uint64_t latency;     // cycles till its response was received
+  char *packet;         // the response, valid within the callback only (nullptr: posted)
+};
+
+// fills in the n-th request, false if there is none left
+typedef std::function<bool(uint64_t n, struct hmc_host_rqst *rqst)> hmc_host_gen;
+typedef std::function<void(const struct hmc_host_cpl *cpl)> hmc_host_cb;
+
+class hmc_host {
+private:
+  struct hmc_host_entry {
+    struct hmc_host_rqst rqst;
+    uint64_t sent;
+    bool busy;
+  };
+  struct hmc_host_slid {
+    unsigned id;
+    std::vector<uint16_t> free_tags;              // stack
+    std::vector<struct hmc_host_entry> entries;   // by tag
+    char *stalled;                                // refused by the slid, nullptr if none
+    uint16_t stalled_tag;
+    uint64_t sent;
+    uint64_t received;
+    uint64_t stalls;
+  };
+
+  hmc_sim *sim;
+  std::vector<struct hmc_host_slid> slids;
+  unsigned next;                                  // round robin
+  uint64_t outstanding;                           // sent or stalled, not yet completed
+  hmc_host_cb cb;
+
+  bool send(struct hmc_host_slid *s, uint16_t tag, char *packet);
+  void complete(struct hmc_host_slid *s, uint16_t tag, char *packet);
+
+public:
+  // window: max. outstanding requests per slid, at most HMC_HOST_TAGS
+  hmc_host(hmc_sim *sim, const std::vector<unsigned> &slids, unsigned window = HMC_HOST_TAGS);
+  ~hmc_host(void);
+
+  ALWAYS_INLINE void set_callback(const hmc_host_cb &cb)
+  {
+    this->cb = cb;
+  }
+
+  // false, if no slid is able to take it (window full or a request stalled)
+  bool can_issue(void);
+  bool issue(const struct hmc_host_rqst *rqst);
+  // retries the stalled requests and takes all responses, which are ready
+  void poll(void);
+  /*
+   * Issues the generator's requests as fast as the slids allow, till all of
+   * them completed. The simulator is clocked by this, cycle by cycle, or with
+   * skip set, skipping the cycles the host only waits. Returns the cycles run.
+   */
+  uint64_t run(const hmc_host_gen &gen, bool skip = false);
+
+  ALWAYS_INLINE uint64_t get_outstanding(void)
+  {
+    return this->outstanding;
+  }
+  uint64_t get_sent(void);
+  uint64_t get_received(void);
+  // retries of stalled requests, which were refused again
+  uint64_t get_stalls(void);
+};
+
+#endif /* #ifndef _HMC_HOST_H_ */
@@ -0,0 +1,209 @@
+#include <cstring>
+#include <iomanip>
+#include "hmc_latency.h"
+
+hmc_histogram::hmc_histogram(void)
+{
+  this->reset();
+}
+
+void hmc_histogram::reset(void)
+{
+  memset(this->buckets, 0, sizeof(this->buckets));
+  this->count = 0;
+  this->sum = 0;
+  this->min = ~0ULL;
+  this->max = 0;
+}
+
+uint64_t hmc_histogram::upper(unsigned idx)
+{
+  if (idx < HMC_HIST_SUB_BUCKETS)
+    return idx;
+  unsigned shift = (idx >> HMC_HIST_SUB_BITS) - 1;
+  uint64_t base = (uint64_t)(HMC_HIST_SUB_BUCKETS + (idx & (HMC_HIST_SUB_BUCKETS - 1))) << shift;
+  return base + ((0x1ULL << shift) - 1);
+}
+
+uint64_t hmc_histogram::percentile(double p) const
+{
+  if (!this->count)
+    return 0;
+  if (p >= 100.0)
+    return this->max;
+
+  uint64_t rank = (uint64_t)(p / 100.0 * this->count + 0.5);
+  if (!rank)
+    rank = 1;
+  uint64_t seen = 0;
+  for (unsigned i = 0; i < HMC_HIST_BUCKETS; i++) {
+    seen += this->buckets[i];
+    if (seen >= rank) {
+      uint64_t v = upper(i);
+      return (v > this->max) ? this->max : v;
+    }
+  }
+  return this->max;
+}
+
+hmc_latency::hmc_latency(void) :
+  rqsts_free(HMC_LATENCY_NONE),
+  all(nullptr)
+{
+  memset(this->outstanding, 0xFF, sizeof(this->outstanding));   // HMC_LATENCY_NONE
+  memset(this->slids, 0, sizeof(this->slids));
+  memset(this->cubes, 0, sizeof(this->cubes));
+  memset(this->vaults, 0, sizeof(this->vaults));
+  memset(this->cmds, 0, sizeof(this->cmds));
+}
+
+hmc_latency::~hmc_latency(void)
+{
+  for (unsigned g = HMC_LAT_ALL; g < HMC_LAT_GROUPS; g++) {
+    hmc_histogram **h;
+    for (unsigned id = 0; (h = this->slot((enum hmc_latency_group)g, id)) != nullptr; id++)
+      delete *h;
+  }
+}
+
+hmc_histogram** hmc_latency::slot(enum hmc_latency_group group, unsigned id)
+{
+  switch (group) {
+  case HMC_LAT_ALL:
+    return !id ? &this->all : nullptr;
+  case HMC_LAT_SLID:
+    return (id < HMC_MAX_SLIDS) ? &this->slids[id] : nullptr;
+  case HMC_LAT_CUBE:
+    return (id < HMC_MAX_DEVS) ? &this->cubes[id] : nullptr;
+  case HMC_LAT_VAULT:
+    return (id < HMC_MAX_DEVS * HMC_NUM_VAULTS) ? &this->vaults[id] : nullptr;
+  case HMC_LAT_CMD:
+    return (id < HMC_CMD_TABLE_SIZE) ? &this->cmds[id] : nullptr;
+  default:
+    return nullptr;
+  }
+}
+
+void hmc_latency::record(enum hmc_latency_group group, unsigned id, uint64_t cycles)
+{
+  hmc_histogram **h = this->slot(group, id);
+  if (*h == nullptr)
+    *h = new hmc_histogram();
+  (*h)->record(cycles);
+}
+
+void hmc_latency::sent(unsigned slid, unsigned tag, uint64_t cycle,
+                       unsigned cube, unsigned vault, unsigned cmd)
+{
+  uint32_t idx = this->rqsts_free;
+  if (idx != HMC_LATENCY_NONE) {
+    this->rqsts_free = this->rqsts[idx].next;
+  }
+  else {
+    idx = this->rqsts.size();
+    this->rqsts.push_back(hmc_latency_rqst());
+  }
+  struct hmc_latency_rqst *r = &this->rqsts[idx];
+  r->cycle = cycle;
+  r->next = HMC_LATENCY_NONE;
+  r->vault = vault;
+  r->cube = cube;
+  r->cmd = cmd;
+
+  auto *q = &this->outstanding[slid][tag];
+  if (q->tail != HMC_LATENCY_NONE)
+    this->rqsts[q->tail].next = idx;
+  else
+    q->head = idx;
+  q->tail = idx;
+}
+
+void hmc_latency::received(unsigned slid, unsigned tag, uint64_t cycle)
+{
+  auto *q = &this->outstanding[slid][tag];
+  uint32_t idx = q->head;
+  if (idx == HMC_LATENCY_NONE)
+    return;
+  struct hmc_latency_rqst *r = &this->rqsts[idx];
+  q->head = r->next;
+  if (q->head == HMC_LATENCY_NONE)
+    q->tail = HMC_LATENCY_NONE;
+  r->next = this->rqsts_free;
+  this->rqsts_free = idx;
+
+  uint64_t cycles = cycle - r->cycle;
+  this->record(HMC_LAT_ALL, 0, cycles);
+  this->record(HMC_LAT_SLID, slid, cycles);
+  this->record(HMC_LAT_CUBE, r->cube, cycles);
+  this->record(HMC_LAT_VAULT, r->cube * HMC_NUM_VAULTS + r->vault, cycles);
+  this->record(HMC_LAT_CMD, r->cmd, cycles);
+}
+
+const hmc_histogram* hmc_latency::get(enum hmc_latency_group group, unsigned id)
+{
+  hmc_histogram **h = this->slot(group, id);
+  return (h != nullptr) ? *h : nullptr;
+}
+
+void hmc_latency::reset(void)
+{
+  for (unsigned g = HMC_LAT_ALL; g < HMC_LAT_GROUPS; g++) {
+    hmc_histogram **h;
+    for (unsigned id = 0; (h = this->slot((enum hmc_latency_group)g, id)) != nullptr; id++) {
+      if (*h != nullptr)
+        (*h)->reset();
+    }
+  }
+}
+
+#define HMC_LATENCY_CMD_NAME(cmd_, ...) \
+  case cmd_: return #cmd_;
+
+static const char* hmc_latency_cmd_name(unsigned cmd)
+{
+  switch (cmd) {
+    HMC_CMD_LIST(HMC_LATENCY_CMD_NAME)
+  default:
+    return "CMC";
+  }
+}
+
+#undef HMC_LATENCY_CMD_NAME
+
+void hmc_latency::report(std::ostream &os)
+{
+  static const char *const groups[HMC_LAT_GROUPS] = { "all", "slid", "cube", "vault", "cmd" };
+  std::ios::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+
+  os << "latency [cycles]: count, min, mean, p50, p99, p99.9, max" << std::endl;
+  for (unsigned g = HMC_LAT_ALL; g < HMC_LAT_GROUPS; g++) {
+    hmc_histogram **h;
+    for (unsigned id = 0; (h = this->slot((enum hmc_latency_group)g, id)) != nullptr; id++) {
+      if (*h == nullptr || !(*h)->get_count())
+        continue;
+
+      os << "  " << groups[g];
+      switch (g) {
+      case HMC_LAT_ALL:
+        break;
+      case HMC_LAT_VAULT:
+        os << " cube" << id / HMC_NUM_VAULTS << ".quad" << (id % HMC_NUM_VAULTS) / (HMC_NUM_VAULTS / HMC_NUM_QUADS)
+           << ".vault" << id % (HMC_NUM_VAULTS / HMC_NUM_QUADS);
+        break;
+      case HMC_LAT_CMD:
+        os << " " << hmc_latency_cmd_name(id);
+        break;
+      default:
+        os << " " << id;
+        break;
+      }
+      os << ": " << (*h)->get_count() << ", " << (*h)->get_min() << ", "
+         << std::fixed << std::setprecision(1) << (*h)->get_mean() << ", "
+         << (*h)->percentile(50.0) << ", " << (*h)->percentile(99.0) << ", "
+         << (*h)->percentile(99.9) << ", " << (*h)->get_max() << std::endl;
+    }
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
@@ -0,0 +1,135 @@
+#ifndef _HMC_LATENCY_H_
+#define _HMC_LATENCY_H_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "config.h"
+#include "hmc_cmd.h"
+#include "hmc_macros.h"
+
+/*
+ * HDR-style histogram: values are put into power of two ranges, each of them
+ * split into HMC_HIST_SUB_BUCKETS linear buckets. Every value is kept with a
+ * relative error below 1 / HMC_HIST_SUB_BUCKETS, values below
+ * HMC_HIST_SUB_BUCKETS are exact.
+ */
+#define HMC_HIST_SUB_BITS     5   // < 3.2% error
+#define HMC_HIST_SUB_BUCKETS  (0x1 << HMC_HIST_SUB_BITS)
+#define HMC_HIST_BUCKETS      ((64 - HMC_HIST_SUB_BITS + 1) << HMC_HIST_SUB_BITS)
+
+class hmc_histogram {
+private:
+  uint64_t buckets[HMC_HIST_BUCKETS];
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+
+  ALWAYS_INLINE static unsigned index(uint64_t value)
+  {
+    if (value < HMC_HIST_SUB_BUCKETS)
+      return value;
+    unsigned shift = 63 - __builtin_clzll(value) - HMC_HIST_SUB_BITS;
+    return ((shift + 1) << HMC_HIST_SUB_BITS) + ((value >> shift) & (HMC_HIST_SUB_BUCKETS - 1));
+  }
+  // highest value, which falls into the bucket
+  static uint64_t upper(unsigned idx);
+
+public:
+  hmc_histogram(void);
+  ~hmc_histogram(void) {}
+
+  ALWAYS_INLINE void record(uint64_t value)
+  {
+    this->buckets[index(value)]++;
+    this->count++;
+    this->sum += value;
+    if (value < this->min)
+      this->min = value;
+    if (value > this->max)
+      this->max = value;
+  }
+  void reset(void);
+
+  ALWAYS_INLINE uint64_t get_count(void) const
+  {
+    return this->count;
+  }
+  ALWAYS_INLINE uint64_t get_min(void) const
+  {
+    return this->count ? this->min : 0;
+  }
+  ALWAYS_INLINE uint64_t get_max(void) const
+  {
+    return this->max;
+  }
+  ALWAYS_INLINE double get_mean(void) const
+  {
+    return this->count ? (double)this->sum / this->count : 0.0;
+  }
+  // percentile in [0, 100], e.g. 99.9
+  uint64_t percentile(double p) const;
+};
+
+enum hmc_latency_group {
+  HMC_LAT_ALL,      // id: 0
+  HMC_LAT_SLID,     // id: slid
+  HMC_LAT_CUBE,     // id: destination cube
+  HMC_LAT_VAULT,    // id: cube * HMC_NUM_VAULTS + quad * vaults per quad + vault
+  HMC_LAT_CMD,      // id: hmc_rqst_t
+  HMC_LAT_GROUPS
+};
+
+/*
+ * End-to-end request latency in cycles, from the request being accepted by
+ * hmc_send_pkt*() till its response is taken by hmc_recv_pkt*(). Requests are
+ * matched by slid and tag, a tag reused while it is still outstanding is
+ * matched first in, first out. Requests without a response (posted ones) are
+ * not measured. Histograms are allocated on their first value.
+ */
+#define HMC_LATENCY_TAGS    0x800   // 11 bit tag
+#define HMC_LATENCY_NONE    (~0U)
+
+class hmc_latency {
+private:
+  struct hmc_latency_rqst {
+    uint64_t cycle;
+    uint32_t next;
+    uint16_t vault;
+    uint8_t cube;
+    uint8_t cmd;
+  };
+  // all requests in flight, linked into a list per slid and tag, or into the free list
+  std::vector<struct hmc_latency_rqst> rqsts;
+  uint32_t rqsts_free;
+  struct {
+    uint32_t head;
+    uint32_t tail;
+  } outstanding[HMC_MAX_SLIDS][HMC_LATENCY_TAGS];
+
+  hmc_histogram *all;
+  hmc_histogram *slids[HMC_MAX_SLIDS];
+  hmc_histogram *cubes[HMC_MAX_DEVS];
+  hmc_histogram *vaults[HMC_MAX_DEVS * HMC_NUM_VAULTS];
+  hmc_histogram *cmds[HMC_CMD_TABLE_SIZE];
+
+  hmc_histogram** slot(enum hmc_latency_group group, unsigned id);
+  void record(enum hmc_latency_group group, unsigned id, uint64_t cycles);
+
+public:
+  hmc_latency(void);
+  ~hmc_latency(void);
+
+  void sent(unsigned slid, unsigned tag, uint64_t cycle,
+            unsigned cube, unsigned vault, unsigned cmd);
+  void received(unsigned slid, unsigned tag, uint64_t cycle);
+
+  // nullptr, if there was no value for the group's id yet
+  const hmc_histogram* get(enum hmc_latency_group group, unsigned id);
+  void reset(void);
+  // one line per histogram: count, min, mean, p50, p99, p99.9, max
+  void report(std::ostream &os);
+};
+
+#endif /* #ifndef _HMC_LATENCY_H_ */
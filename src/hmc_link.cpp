@@ -2,6 +2,12 @@
 #include "config.h"
 #include "hmc_link.h"
 #include "hmc_module.h"
+#ifdef HMC_LOGGING
+# include "hmc_cube.h"
+#endif /* #ifdef HMC_LOGGING */
+#ifdef HMC_USES_COUNTERS
+# include "hmc_counters.h"
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 hmc_link::hmc_link(uint64_t *i_cur_cycle, enum hmc_link_type type,
                    hmc_module *module, hmc_cube *cube,
@@ -64,6 +70,12 @@ void hmc_link::set_binding(hmc_link *part)
 {
   this->tx = part->__get_rx_q();
   this->binding = part;
+#ifdef HMC_LOGGING
+  this->trace_ids.fromCubId = (!part->cube) ? -1 : part->cube->get_id();
+  this->trace_ids.toCubId = (!this->cube) ? -1 : this->cube->get_id();
+  this->trace_ids.fromId = part->module->get_id();
+  this->trace_ids.toId = this->module->get_id();
+#endif /* #ifdef HMC_LOGGING */
 }
 
 
@@ -93,3 +105,12 @@ bool hmc_link::notify_up(unsigned id)
   return true;
 #endif /* #ifdef HMC_USES_NOTIFY */
 }
+
+#ifdef HMC_USES_COUNTERS
+// the receiving end: rx_q holds what the other end transmits
+void hmc_link::collect_counters(hmc_counters *ctrs, const std::string &prefix)
+{
+  ctrs->add(prefix + ".q", this->rx_q.get_counters(), hmc_queue_counter_names);
+  ctrs->add(prefix + ".fifo", this->rx_fifo_out.get_counters(), hmc_fifo_counter_names);
+}
+#endif /* #ifdef HMC_USES_COUNTERS */
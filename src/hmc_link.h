@@ -2,6 +2,9 @@
 #define _HMC_LINK_H_
 
 #include <cstdint>
+#ifdef HMC_USES_COUNTERS
+# include <string>
+#endif /* #ifdef HMC_USES_COUNTERS */
 #include "hmc_link_fifo.h"
 #include "hmc_link_queue.h"
 #include "hmc_notify.h"
@@ -9,6 +12,9 @@
 
 class hmc_module;
 class hmc_cube;
+#ifdef HMC_USES_COUNTERS
+class hmc_counters;
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 enum hmc_link_type {
   HMC_LINK_EXTERN    = 0x0,
@@ -18,6 +24,15 @@ enum hmc_link_type {
   HMC_LINK_SLID      = 0x4
 };
 
+#ifdef HMC_LOGGING
+struct hmc_link_trace_ids {
+  int fromCubId;
+  int toCubId;
+  int fromId;
+  int toId;
+};
+#endif /* #ifdef HMC_LOGGING */
+
 class hmc_link : private hmc_notify_cl {
 private:
   hmc_module *module;
@@ -30,6 +45,8 @@ private:
 
 #ifdef HMC_LOGGING
   hmc_cube *cube;
+  // ids of both ends as traced, taken once the link is bound (-1: no cube)
+  struct hmc_link_trace_ids trace_ids;
 #endif /* #ifdef HMC_LOGGING */
 
   // to bind the other end ...
@@ -71,6 +88,10 @@ public:
   {
     return this->cube;
   }
+  ALWAYS_INLINE const struct hmc_link_trace_ids* get_trace_ids(void)
+  {
+    return &this->trace_ids;
+  }
 #endif /* #ifdef HMC_LOGGING */
 
   void set_ilink_notify(unsigned notifyid, unsigned id, hmc_notify *queuenotify, hmc_notify *bufnotify);
@@ -82,7 +103,19 @@ public:
   void set_binding(hmc_link* part);
 
   void clock(void);
+  ALWAYS_INLINE uint64_t next_event(void)
+  {
+    return this->rx_q.next_event();
+  }
+  ALWAYS_INLINE void fast_forward(uint64_t cycles)
+  {
+    this->rx_q.fast_forward(cycles);
+  }
   bool notify_up(unsigned id);
+
+#ifdef HMC_USES_COUNTERS
+  void collect_counters(hmc_counters *ctrs, const std::string &prefix);
+#endif /* #ifdef HMC_USES_COUNTERS */
 };
 
 #endif /* #ifndef _HMC_LINK_H_ */
@@ -2,6 +2,8 @@
 #include "hmc_link_fifo.h"
 #include "hmc_notify.h"
 #include "hmc_link.h"
+#include "hmc_ring.h"
+#include "config.h"
 #ifdef HMC_LOGGING
 # include "hmc_module.h"
 # include "hmc_packet.h"
@@ -17,20 +19,44 @@ hmc_link_fifo::hmc_link_fifo(uint64_t *cur_cycle, hmc_notify *notify, hmc_link *
   link(link),
 #endif /* #ifdef HMC_LOGGING */
   bitoccupation(0),
-  bitoccupationmax(0)
+  bitoccupationmax(0),
+  pkts(new char*[HMC_RING_INIT_SLOTS]),
+  lens(new unsigned[HMC_RING_INIT_SLOTS]),
+  head(0),
+  size(0),
+  mask(HMC_RING_INIT_SLOTS - 1)
 #ifdef HMC_USES_NOTIFY
   , notify(notify)
 #endif /* #ifdef HMC_USES_NOTIFY */
+#ifdef HMC_USES_COUNTERS
+  , counters(HMC_CTR_FIFO_NUM)
+#endif /* #ifdef HMC_USES_COUNTERS */
 {
 }
 
 hmc_link_fifo::~hmc_link_fifo(void)
 {
+  delete[] this->pkts;
+  delete[] this->lens;
+}
+
+void hmc_link_fifo::grow(unsigned slots)
+{
+  unsigned newcap = hmc_ring_roundup(slots);
+  if (newcap <= this->mask + 1)
+    return;
+
+  hmc_ring_relocate(this->pkts, this->head, this->size, this->mask, newcap);
+  hmc_ring_relocate(this->lens, this->head, this->size, this->mask, newcap);
+  this->head = 0;
+  this->mask = newcap - 1;
 }
 
 void hmc_link_fifo::adjust_size(unsigned bitsize)
 {
   this->bitoccupationmax = bitsize * 1000;
+  // every packet reserved at least one FLIT -> upper bound of entries
+  this->grow(bitsize / FLIT_WIDTH);
 }
 
 bool hmc_link_fifo::reserve_space(unsigned packetleninbit)
@@ -46,30 +72,34 @@ bool hmc_link_fifo::reserve_space(unsigned packetleninbit)
 void hmc_link_fifo::push_back_set_avail(char *packet, unsigned packetleninbit)
 {
 #ifdef HMC_USES_NOTIFY
-  if (!this->buf.size())
+  if (!this->size)
     this->notify->notify_add(0);
 #endif /* #ifdef HMC_USES_NOTIFY */
-  this->buf.push_back(std::make_pair(packet, packetleninbit));
+#ifdef HMC_USES_COUNTERS
+  this->counters.inc(HMC_CTR_FIFO_PACKETS);
+  this->counters.inc(HMC_CTR_FIFO_OCCUPANCY, this->size);
+  this->counters.max(HMC_CTR_FIFO_MAX, this->size + 1);
+#endif /* #ifdef HMC_USES_COUNTERS */
+  if (__builtin_expect(this->size > this->mask, 0))
+    this->grow(this->size + 1);
+  unsigned idx = (this->head + this->size++) & this->mask;
+  this->pkts[idx] = packet;
+  this->lens[idx] = packetleninbit;
 }
 
+// modules clocked by a shared notify (e.g. hmc_bobsim) ask an empty fifo as well
 char* hmc_link_fifo::front(unsigned *packetleninbit)
 {
-#ifndef HMC_USES_NOTIFY
-  if (this->buf.size())
-#endif /* #ifndef HMC_USES_NOTIFY */
-  {
-    auto front = this->buf.front();
-    *packetleninbit = front.second / 1000;
-    return front.first;
+  if (this->size) {
+    *packetleninbit = this->lens[this->head] / 1000;
+    return this->pkts[this->head];
   }
-#ifndef HMC_USES_NOTIFY
   return nullptr;
-#endif /* #ifndef HMC_USES_NOTIFY */
 }
 
 void hmc_link_fifo::pop_front(void)
 {
-  switch (this->buf.size()) {
+  switch (this->size) {
   case 0:
     break;
   case 1:
@@ -81,28 +111,26 @@ void hmc_link_fifo::pop_front(void)
   // because afterwards there is nothing left
   default:
   {
-    auto front = this->buf.front();
+    unsigned front = this->head;
 #ifdef HMC_LOGGING
-    char *packet = front.first;
-    int fromId = this->link->get_binding()->get_module()->get_id();
-    int toId = this->link->get_module()->get_id();
-    hmc_cube *toCub = this->link->get_cube();
-    int toCubId = (!toCub) ? -1 : toCub->get_id();
-    hmc_cube *fromCub = this->link->get_binding()->get_cube();
-    int fromCubId = (!fromCub) ? -1 : fromCub->get_id();
+    if (hmc_trace::is_active(this->link->get_type(), *cur_cycle)) {
+      char *packet = this->pkts[front];
+      const struct hmc_link_trace_ids *ids = this->link->get_trace_ids();
 
-    uint64_t header = HMC_PACKET_HEADER(packet);
-    if (HMCSIM_PACKET_IS_REQUEST(header)) {
-      uint64_t tail = HMC_PACKET_REQ_TAIL(packet);
-      hmc_trace::trace_out_rqst(*cur_cycle, (uint64_t)packet, this->link->get_type(), fromCubId, toCubId, fromId, toId, header, tail);
-    }
-    else {
-      uint64_t tail = HMC_PACKET_RESP_TAIL(packet);
-      hmc_trace::trace_out_rsp(*cur_cycle, (uint64_t)packet, this->link->get_type(), fromCubId, toCubId, fromId, toId, header, tail);
+      uint64_t header = HMC_PACKET_HEADER(packet);
+      if (HMCSIM_PACKET_IS_REQUEST(header)) {
+        uint64_t tail = HMC_PACKET_REQ_TAIL(packet);
+        hmc_trace::trace_out_rqst(*cur_cycle, (uint64_t)packet, this->link->get_type(), ids->fromCubId, ids->toCubId, ids->fromId, ids->toId, header, tail);
+      }
+      else {
+        uint64_t tail = HMC_PACKET_RESP_TAIL(packet);
+        hmc_trace::trace_out_rsp(*cur_cycle, (uint64_t)packet, this->link->get_type(), ids->fromCubId, ids->toCubId, ids->fromId, ids->toId, header, tail);
+      }
     }
 #endif /* #ifdef HMC_LOGGING */
-    this->bitoccupation -= front.second;
-    this->buf.pop_front();
+    this->bitoccupation -= this->lens[front];
+    this->head = (front + 1) & this->mask;
+    this->size--;
   }
   }
 }
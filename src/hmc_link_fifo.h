@@ -2,8 +2,10 @@
 #define _HMC_LINK_BUF_H_
 
 #include <cstdint>
-#include <list>
-#include <utility>
+#include "hmc_macros.h"
+#ifdef HMC_USES_COUNTERS
+# include "hmc_counters.h"
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 class hmc_notify;
 class hmc_link;
@@ -17,10 +19,20 @@ private:
 
   unsigned bitoccupation;
   unsigned bitoccupationmax;
-  std::list< std::pair<char*,unsigned> > buf;
+  // ring buffer (SoA): packetptr, totalsizeinbits
+  char **pkts;
+  unsigned *lens;
+  unsigned head;
+  unsigned size;
+  unsigned mask;
 #ifdef HMC_USES_NOTIFY
   hmc_notify *notify;
 #endif /* #ifdef HMC_USES_NOTIFY */
+#ifdef HMC_USES_COUNTERS
+  hmc_counter_block counters;
+#endif /* #ifdef HMC_USES_COUNTERS */
+
+  void grow(unsigned slots);
 
 public:
   explicit hmc_link_fifo(uint64_t *cycle, hmc_notify *notify, hmc_link *link);
@@ -31,8 +43,23 @@ public:
   bool reserve_space(unsigned packetleninbit);
   void push_back_set_avail(char *packet, unsigned packetleninbit);
 
+  ALWAYS_INLINE unsigned get_free(void)
+  {
+    return this->bitoccupationmax - this->bitoccupation;
+  }
+  ALWAYS_INLINE bool empty(void)
+  {
+    return !this->size;
+  }
   char *front(unsigned *packetleninbit);
   void pop_front(void);
+
+#ifdef HMC_USES_COUNTERS
+  ALWAYS_INLINE const hmc_counter_block* get_counters(void)
+  {
+    return &this->counters;
+  }
+#endif /* #ifdef HMC_USES_COUNTERS */
 };
 
 #endif /* #ifndef _HMC_LINK_BUF_H_ */
@@ -5,6 +5,7 @@
 #include "hmc_notify.h"
 #include "config.h"
 #include "hmc_module.h"
+#include "hmc_ring.h"
 #ifdef HMC_LOGGING
 # include "hmc_packet.h"
 # include "hmc_decode.h"
@@ -29,12 +30,44 @@ hmc_link_queue::hmc_link_queue(uint64_t *cur_cycle, hmc_link_fifo *buf,
 #ifdef HMC_USES_NOTIFY
   notify(notify),
 #endif /* #ifdef HMC_USES_NOTIFY */
+  pkts(new char*[HMC_RING_INIT_SLOTS]),
+  uis(new unsigned[HMC_RING_INIT_SLOTS]),
+  lens(new unsigned[HMC_RING_INIT_SLOTS]),
+  cycles(new uint64_t[HMC_RING_INIT_SLOTS]),
+  head(0),
+  size(0),
+  mask(HMC_RING_INIT_SLOTS - 1),
   buf(buf)
+#ifdef HMC_USES_THREADS
+  , staged(false),
+  staged_bitoccupation(0)
+#endif /* #ifdef HMC_USES_THREADS */
+#ifdef HMC_USES_COUNTERS
+  , counters(HMC_CTR_QUEUE_NUM)
+#endif /* #ifdef HMC_USES_COUNTERS */
 {
 }
 
 hmc_link_queue::~hmc_link_queue(void)
 {
+  delete[] this->pkts;
+  delete[] this->uis;
+  delete[] this->lens;
+  delete[] this->cycles;
+}
+
+void hmc_link_queue::grow(unsigned slots)
+{
+  unsigned newcap = hmc_ring_roundup(slots);
+  if (newcap <= this->mask + 1)
+    return;
+
+  hmc_ring_relocate(this->pkts, this->head, this->size, this->mask, newcap);
+  hmc_ring_relocate(this->uis, this->head, this->size, this->mask, newcap);
+  hmc_ring_relocate(this->lens, this->head, this->size, this->mask, newcap);
+  hmc_ring_relocate(this->cycles, this->head, this->size, this->mask, newcap);
+  this->head = 0;
+  this->mask = newcap - 1;
 }
 
 void hmc_link_queue::set_notifyid(unsigned notifyid, unsigned id)
@@ -52,94 +85,158 @@ void hmc_link_queue::re_adjust(unsigned link_bitwidth, float link_bitrate)
 // to avoid working on floats, we multiple it so that an unsigned can be used
   this->bitoccupationmax = bitrate * link_bitwidth * 1000;
   this->bitrate = bitrate * 1000.0;
+
+  // the occupation bounds the in flight packets (at least 1 FLIT each), the
+  // ones already fully transmitted but not yet taken by the fifo come on top
+  // and are handled by growing in push_back
+  this->grow(this->bitoccupationmax / ((FLIT_WIDTH * 1000) / link_bitwidth) + 1);
 }
 
 bool hmc_link_queue::has_space(unsigned packetleninbit)
 {
   assert(this->bitoccupationmax); // otherwise not initialized!
+#ifdef HMC_USES_THREADS
+  if (this->staged)
+    return (this->staged_bitoccupation < this->bitoccupationmax);
+#endif /* #ifdef HMC_USES_THREADS */
   return (this->bitoccupation < this->bitoccupationmax);
 }
 
-bool hmc_link_queue::push_back(char *packet, unsigned packetleninbit)
+void hmc_link_queue::enqueue(char *packet, unsigned packetleninbit)
 {
-  if (__builtin_expect(this->bitoccupation /* + packetleninbit */ < this->bitoccupationmax, 1)) {
 #ifdef HMC_USES_NOTIFY
-    if (!this->bitoccupation)
-      this->notify->notify_add(this->notifyid);
+  if (!this->bitoccupation)
+    this->notify->notify_add(this->notifyid);
 #endif /* #ifdef HMC_USES_NOTIFY */
 
-    packetleninbit *= 1000;
-    unsigned UI = packetleninbit / this->bitwidth;
-    this->bitoccupation += UI;
-    this->list.push_back(std::make_tuple(packet, UI, packetleninbit, *this->cur_cycle));
+  packetleninbit *= 1000;
+  unsigned UI = packetleninbit / this->bitwidth;
+  this->bitoccupation += UI;
+  if (__builtin_expect(this->size > this->mask, 0))
+    this->grow(this->size + 1);
+  unsigned idx = (this->head + this->size++) & this->mask;
+  this->pkts[idx] = packet;
+  this->uis[idx] = UI;
+  this->lens[idx] = packetleninbit;
+  this->cycles[idx] = *this->cur_cycle;
+}
+
 #ifdef HMC_LOGGING
-    int fromId = this->link->get_binding()->get_module()->get_id();
-    int toId = this->link->get_module()->get_id();
-    hmc_cube *toCub = this->link->get_cube();
-    int toCubId = (!toCub) ? -1 : toCub->get_id();
-    hmc_cube *fromCub = this->link->get_binding()->get_cube();
-    int fromCubId = (!fromCub) ? -1 : fromCub->get_id();
-
-    uint64_t header = HMC_PACKET_HEADER(packet);
-    if (HMCSIM_PACKET_IS_REQUEST(header)) {
-      uint64_t tail = HMC_PACKET_REQ_TAIL(packet);
-      hmc_trace::trace_in_rqst(*cur_cycle, (uint64_t)packet, this->link->get_type(), fromCubId, toCubId, fromId, toId, header, tail);
-    }
-    else {
-      uint64_t tail = HMC_PACKET_RESP_TAIL(packet);
-      hmc_trace::trace_in_rsp(*cur_cycle, (uint64_t)packet, this->link->get_type(), fromCubId, toCubId, fromId, toId, header, tail);
+void hmc_link_queue::trace_push(char *packet)
+{
+  const struct hmc_link_trace_ids *ids = this->link->get_trace_ids();
+
+  uint64_t header = HMC_PACKET_HEADER(packet);
+  if (HMCSIM_PACKET_IS_REQUEST(header)) {
+    uint64_t tail = HMC_PACKET_REQ_TAIL(packet);
+    hmc_trace::trace_in_rqst(*cur_cycle, (uint64_t)packet, this->link->get_type(), ids->fromCubId, ids->toCubId, ids->fromId, ids->toId, header, tail);
+  }
+  else {
+    uint64_t tail = HMC_PACKET_RESP_TAIL(packet);
+    hmc_trace::trace_in_rsp(*cur_cycle, (uint64_t)packet, this->link->get_type(), ids->fromCubId, ids->toCubId, ids->fromId, ids->toId, header, tail);
+  }
+}
+#endif /* #ifdef HMC_LOGGING */
+
+bool hmc_link_queue::push_back(char *packet, unsigned packetleninbit)
+{
+#ifdef HMC_USES_THREADS
+  if (this->staged) {
+    if (this->staged_bitoccupation >= this->bitoccupationmax) {
+#ifdef HMC_USES_COUNTERS
+      this->counters.inc(HMC_CTR_QUEUE_STALLS);
+#endif /* #ifdef HMC_USES_COUNTERS */
+      return false;
     }
+    this->staged_bitoccupation += (packetleninbit * 1000) / this->bitwidth;
+    this->stage.push_back(std::make_pair(packet, packetleninbit));
+#ifdef HMC_USES_COUNTERS
+    this->counters.inc(HMC_CTR_QUEUE_PACKETS);
+    this->counters.inc(HMC_CTR_QUEUE_FLITS, packetleninbit / FLIT_WIDTH);
+#endif /* #ifdef HMC_USES_COUNTERS */
+#ifdef HMC_LOGGING
+    if (hmc_trace::is_active(this->link->get_type(), *this->cur_cycle))
+      this->trace_push(packet);
 #endif /* #ifdef HMC_LOGGING */
     return true;
   }
+#endif /* #ifdef HMC_USES_THREADS */
+  if (__builtin_expect(this->bitoccupation /* + packetleninbit */ < this->bitoccupationmax, 1)) {
+    this->enqueue(packet, packetleninbit);
+#ifdef HMC_LOGGING
+    if (hmc_trace::is_active(this->link->get_type(), *this->cur_cycle))
+      this->trace_push(packet);
+#endif /* #ifdef HMC_LOGGING */
+#ifdef HMC_USES_COUNTERS
+    this->counters.inc(HMC_CTR_QUEUE_PACKETS);
+    this->counters.inc(HMC_CTR_QUEUE_FLITS, packetleninbit / FLIT_WIDTH);
+#endif /* #ifdef HMC_USES_COUNTERS */
+    return true;
+  }
 
+#ifdef HMC_USES_COUNTERS
+  this->counters.inc(HMC_CTR_QUEUE_STALLS);
+#endif /* #ifdef HMC_USES_COUNTERS */
   return false;
 }
 
 void hmc_link_queue::clock(void)
 {
 #ifdef HMC_USES_NOTIFY
-  assert(!this->list.empty());
+  assert(this->size);
 #else
   if (this->bitoccupation) // speedup, it could be that clock is issued, but there is no bitoccupation, but still elements left, since it could not yet fit into the buffer
 #endif /* #ifdef HMC_USES_NOTIFY */
   {
     uint64_t ccycle = *this->cur_cycle;
     unsigned tbitrate = this->bitrate;
-    auto it = this->list.begin();
+    unsigned i = 0;
+#ifdef HMC_USES_COUNTERS
+    bool sent = false;
+#endif /* #ifdef HMC_USES_COUNTERS */
     do { // we know already that there are elements in it .. use do { } while( );
-      unsigned UI = std::get<1>(*it);
-      if (std::get<3>(*it) == ccycle)
+      unsigned idx = (this->head + i) & this->mask;
+      unsigned UI = this->uis[idx];
+      if (this->cycles[idx] == ccycle)
         break;
 
       if (UI >= tbitrate) {
         if (this->buf->reserve_space(tbitrate * this->bitwidth)) {
-          std::get<1>(*it) -= tbitrate;
+          this->uis[idx] -= tbitrate;
           this->bitoccupation -= tbitrate;
+#ifdef HMC_USES_COUNTERS
+          sent = true;
+#endif /* #ifdef HMC_USES_COUNTERS */
         }
         break;
       }
       else if (UI) {
         if (this->buf->reserve_space(UI * this->bitwidth)) {
-          std::get<1>(*it) = 0;
+          this->uis[idx] = 0;
           this->bitoccupation -= UI;
           tbitrate -= UI;
+#ifdef HMC_USES_COUNTERS
+          sent = true;
+#endif /* #ifdef HMC_USES_COUNTERS */
         }
         else
           break;
       }
-      ++it;
-    } while (it != this->list.end());
+    } while (++i < this->size);
+#ifdef HMC_USES_COUNTERS
+    if (sent)
+      this->counters.inc(HMC_CTR_QUEUE_BUSY);
+#endif /* #ifdef HMC_USES_COUNTERS */
   }
 
 #ifndef HMC_USES_NOTIFY
-  if (this->list.empty())
+  if (!this->size)
     return;
 #endif /* #ifndef HMC_USES_NOTIFY */
 
-  auto front = this->list.front();
-  if (!std::get<1>(front)) {
-    char *packet = std::get<0>(front);
+  unsigned front = this->head;
+  if (!this->uis[front]) {
+    char *packet = this->pkts[front];
 //#ifdef HMC_LOGGING
 //    int fromId = this->link->get_binding()->get_module()->get_id();
 //    int toId = this->link->get_module()->get_id();
@@ -158,11 +255,100 @@ void hmc_link_queue::clock(void)
 //      hmc_trace::trace_out_rsp(*cur_cycle, (uint64_t)packet, this->link->get_type(), fromCubId, toCubId, fromId, toId, header, tail);
 //    }
 //#endif /* #ifdef HMC_LOGGING */
-    this->buf->push_back_set_avail(packet, std::get<2>(front));
-    this->list.pop_front();
+    this->buf->push_back_set_avail(packet, this->lens[front]);
+    this->head = (front + 1) & this->mask;
+    this->size--;
 #ifdef HMC_USES_NOTIFY
-    if (__builtin_expect(!this->list.size(), 0))
+    if (__builtin_expect(!this->size, 0))
       this->notify->notify_del(this->notifyid);
 #endif /* #ifdef HMC_USES_NOTIFY */
   }
 }
+
+#ifdef HMC_USES_THREADS
+void hmc_link_queue::set_staged(void)
+{
+  this->staged = true;
+  this->stage.reserve(HMC_RING_INIT_SLOTS);
+}
+
+// called single threaded after all cubes are clocked, the entries still carry the cycle they were pushed in
+void hmc_link_queue::commit(void)
+{
+  for (auto it = this->stage.begin(); it != this->stage.end(); ++it)
+    this->enqueue(it->first, it->second);
+  this->stage.clear();
+}
+#endif /* #ifdef HMC_USES_THREADS */
+
+/*
+ * Between two events, clock() only counts down the front packet by 'bitrate' UI
+ * and reserves the transmitted bits in the fifo. This returns how many cycles
+ * it does nothing else, 0 if the next cycle does more (packet completes, small
+ * packets follow up) and ~0 if it is stalled by a full fifo: the fifo only gets
+ * space by its consumer, which reports that as its own event.
+ */
+unsigned hmc_link_queue::countdown_ticks(void)
+{
+  unsigned UI = this->uis[this->head];
+  if (!UI)
+    return 0;
+
+  unsigned tbitrate = this->bitrate;
+  unsigned free = this->buf->get_free();
+  if (((UI < tbitrate) ? UI : tbitrate) * this->bitwidth > free)
+    return ~0;
+
+  if (UI <= tbitrate)
+    return 0;
+
+  unsigned ticks = (UI - 1) / tbitrate;
+  unsigned reserves = free / (tbitrate * this->bitwidth);
+  return (ticks < reserves) ? ticks : reserves;
+}
+
+uint64_t hmc_link_queue::next_event(void)
+{
+  if (!this->size)
+    return HMC_NO_EVENT;
+
+  unsigned ticks = this->countdown_ticks();
+  return (ticks == ~0u) ? HMC_NO_EVENT : ticks + 1;
+}
+
+uint64_t hmc_link_queue::space_event(void)
+{
+  if (this->bitoccupation < this->bitoccupationmax)
+    return 1;
+
+  unsigned ticks = this->countdown_ticks();
+  if (ticks == ~0u)
+    return HMC_NO_EVENT;
+  if (!ticks)
+    return 1;
+  return (this->bitoccupation - this->bitoccupationmax) / this->bitrate + 1;
+}
+
+void hmc_link_queue::fast_forward(uint64_t cycles)
+{
+  if (!this->size)
+    return;
+
+  unsigned UI = this->uis[this->head];
+  unsigned tbitrate = this->bitrate;
+  if (!UI || UI <= tbitrate)
+    return; // either an event (never skipped) or stalled
+
+  uint64_t reserves = this->buf->get_free() / (tbitrate * this->bitwidth);
+  unsigned ticks = (cycles < reserves) ? cycles : reserves;
+  assert(UI > ticks * tbitrate);
+
+  this->uis[this->head] -= ticks * tbitrate;
+  this->bitoccupation -= ticks * tbitrate;
+  bool reserved = this->buf->reserve_space(ticks * tbitrate * this->bitwidth);
+  assert(reserved);
+  (void)reserved;
+#ifdef HMC_USES_COUNTERS
+  this->counters.inc(HMC_CTR_QUEUE_BUSY, ticks);
+#endif /* #ifdef HMC_USES_COUNTERS */
+}
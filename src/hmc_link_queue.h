@@ -2,17 +2,22 @@
 #define _HMC_LINK_QUEUE_H_
 
 #include <cstdint>
-#include <list>
-#include <tuple>
+#ifdef HMC_USES_THREADS
+# include <utility>
+# include <vector>
+#endif /* #ifdef HMC_USES_THREADS */
 #include "config.h"
 #include "hmc_macros.h"
+#ifdef HMC_USES_COUNTERS
+# include "hmc_counters.h"
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 class hmc_link;
 class hmc_link_fifo;
 class hmc_notify;
 class hmc_module;
 
-// tuple( packetptr, amount of cycles, totalsizeinbits );
+// ring buffer (SoA): packetptr, remaining UI, totalsizeinbits, enqueue cycle
 class hmc_link_queue {
 private:
   unsigned id;
@@ -31,9 +36,31 @@ private:
 #ifdef HMC_USES_NOTIFY
   hmc_notify *notify;
 #endif /* #ifdef HMC_USES_NOTIFY */
-  std::list< std::tuple<char*, unsigned, unsigned, uint64_t> > list;
+  char **pkts;
+  unsigned *uis;
+  unsigned *lens;
+  uint64_t *cycles;
+  unsigned head;
+  unsigned size;
+  unsigned mask;
   hmc_link_fifo *buf;
 
+#ifdef HMC_USES_THREADS
+  // pushed from another thread than the one clocking it -> buffered till commit()
+  bool staged;
+  unsigned staged_bitoccupation;
+  std::vector< std::pair<char*, unsigned> > stage;
+#endif /* #ifdef HMC_USES_THREADS */
+#ifdef HMC_USES_COUNTERS
+  hmc_counter_block counters;
+#endif /* #ifdef HMC_USES_COUNTERS */
+
+  void grow(unsigned slots);
+  void enqueue(char *packet, unsigned packetleninbit);
+  unsigned countdown_ticks(void);
+#ifdef HMC_LOGGING
+  void trace_push(char *packet);
+#endif /* #ifdef HMC_LOGGING */
 
 public:
   hmc_link_queue(uint64_t* cur_cycle, hmc_link_fifo *buf, hmc_notify *notify,
@@ -49,9 +76,46 @@ public:
   void re_adjust(unsigned link_bitwidth, float link_bitrate);
 
   bool has_space(unsigned packetleninbit);
+  // as has_space() sees it
+  ALWAYS_INLINE unsigned get_occupation(void)
+  {
+#ifdef HMC_USES_THREADS
+    if (this->staged)
+      return this->staged_bitoccupation;
+#endif /* #ifdef HMC_USES_THREADS */
+    return this->bitoccupation;
+  }
   bool push_back(char *packet, unsigned packetleninbit);
 
+#ifdef HMC_USES_COUNTERS
+  ALWAYS_INLINE const hmc_counter_block* get_counters(void)
+  {
+    return &this->counters;
+  }
+  // push_back() calls, which fast_forward() of the sending side skipped
+  ALWAYS_INLINE void count_stalls(uint64_t n)
+  {
+    this->counters.inc(HMC_CTR_QUEUE_STALLS, n);
+  }
+#endif /* #ifdef HMC_USES_COUNTERS */
+
   void clock(void);
+
+#ifdef HMC_USES_THREADS
+  void set_staged(void);
+  // has_space() decides on the occupation at the begin of the cycle, as the clocking side runs concurrently
+  ALWAYS_INLINE void stage_begin(void)
+  {
+    this->staged_bitoccupation = this->bitoccupation;
+  }
+  void commit(void);
+#endif /* #ifdef HMC_USES_THREADS */
+
+  // event skipping: cycles till the next clock() does more than counting down the front packet
+  uint64_t next_event(void);
+  // cycles till has_space() might become true
+  uint64_t space_event(void);
+  void fast_forward(uint64_t cycles);
 };
 
 #endif /* #ifndef _HMC_LINK_QUEUE_H_ */
@@ -4,4 +4,7 @@
 #define ALWAYS_INLINE             inline __attribute__((always_inline))
 #define elemsof( x )              (sizeof(x) / sizeof((x)[0]))
 
+// next_event(): cycles till something changes, nothing pending -> never
+#define HMC_NO_EVENT              (~0ull)
+
 #endif /* #ifndef _HMC_MACROS_H_ */
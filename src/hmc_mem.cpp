@@ -0,0 +1,270 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include "hmc_mem.h"
+
+hmc_mem::hmc_mem(uint64_t size) :
+  mapping(nullptr),
+  mapping_size(0)
+{
+  if (getenv("HMCSIM_MEM_MMAP") != nullptr) {
+    void *m = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (m == MAP_FAILED)
+      std::cerr << "WARNING: HMCSIM_MEM_MMAP: mapping " << size << " bytes failed, falling back to sparse pages" << std::endl;
+    else {
+      this->mapping = (uint8_t*)m;
+      this->mapping_size = size;
+    }
+  }
+}
+
+hmc_mem::~hmc_mem(void)
+{
+  if (this->mapping != nullptr)
+    munmap(this->mapping, this->mapping_size);
+  for (auto it = this->pages.begin(); it != this->pages.end(); ++it)
+    delete[] it->second;
+}
+
+// returns nullptr for an untouched page, if it isn't to be allocated
+uint8_t* hmc_mem::page(uint64_t addr, bool alloc)
+{
+  uint64_t base = addr & ~(uint64_t)(HMC_MEM_PAGE_SIZE - 1);
+  if (base < this->mapping_size)
+    return this->mapping + base;
+
+  auto it = this->pages.find(base);
+  if (it != this->pages.end())
+    return it->second;
+  if (!alloc)
+    return nullptr;
+
+  uint8_t *p = new uint8_t[HMC_MEM_PAGE_SIZE]();
+  this->pages[base] = p;
+  return p;
+}
+
+void hmc_mem::read(uint64_t addr, void *data, unsigned bytes)
+{
+  uint8_t *d = (uint8_t*)data;
+  while (bytes) {
+    unsigned offset = addr & (HMC_MEM_PAGE_SIZE - 1);
+    unsigned len = HMC_MEM_PAGE_SIZE - offset;
+    if (len > bytes)
+      len = bytes;
+
+    uint8_t *p = this->page(addr, false);
+    if (p == nullptr)
+      memset(d, 0, len);
+    else
+      memcpy(d, p + offset, len);
+
+    addr += len;
+    d += len;
+    bytes -= len;
+  }
+}
+
+void hmc_mem::write(uint64_t addr, const void *data, unsigned bytes)
+{
+  const uint8_t *d = (const uint8_t*)data;
+  while (bytes) {
+    unsigned offset = addr & (HMC_MEM_PAGE_SIZE - 1);
+    unsigned len = HMC_MEM_PAGE_SIZE - offset;
+    if (len > bytes)
+      len = bytes;
+
+    memcpy(this->page(addr, true) + offset, d, len);
+
+    addr += len;
+    d += len;
+    bytes -= len;
+  }
+}
+
+/*
+ * Operands are little endian 8 byte words of the request payload, 16 byte
+ * operands are [0] low and [1] high word. Atomics return the original memory
+ * content (if they respond with data at all).
+ */
+void hmc_mem::process(hmc_rqst_t cmd, uint64_t addr,
+                      const uint64_t *payload, unsigned payload_bytes,
+                      uint64_t *rsp_payload, unsigned rsp_bytes, bool *af)
+{
+  uint64_t orig[2];
+  uint64_t mem[2];
+
+  switch (cmd) {
+  case WR16:
+  case WR32:
+  case WR48:
+  case WR64:
+  case WR80:
+  case WR96:
+  case WR112:
+  case WR128:
+  case WR256:
+  case P_WR16:
+  case P_WR32:
+  case P_WR48:
+  case P_WR64:
+  case P_WR80:
+  case P_WR96:
+  case P_WR112:
+  case P_WR128:
+  case P_WR256:
+    this->write(addr, payload, payload_bytes);
+    return;
+
+  case RD16:
+  case RD32:
+  case RD48:
+  case RD64:
+  case RD80:
+  case RD96:
+  case RD112:
+  case RD128:
+  case RD256:
+    this->read(addr, rsp_payload, rsp_bytes);
+    return;
+
+  case BWR:
+  case P_BWR:
+  case BWR8R:
+  case TWOADD8:
+  case P_2ADD8:
+  case TWOADDS8R:
+  case ADD16:
+  case P_ADD16:
+  case ADDS16R:
+  case INC8:
+  case P_INC8:
+  case XOR16:
+  case OR16:
+  case NOR16:
+  case AND16:
+  case NAND16:
+  case CASGT8:
+  case CASGT16:
+  case CASLT8:
+  case CASLT16:
+  case CASEQ8:
+  case CASZERO16:
+  case EQ8:
+  case EQ16:
+  case SWAP16:
+    break;
+
+  default:
+    // mode register accesses, flow control and CMC don't touch the memory
+    return;
+  }
+
+  // a too short request operates with zeros
+  uint64_t op[2] = { 0, 0 };
+  memcpy(op, payload, (payload_bytes < sizeof(op)) ? payload_bytes : sizeof(op));
+
+  this->read(addr, orig, sizeof(orig));
+  mem[0] = orig[0];
+  mem[1] = orig[1];
+
+  switch (cmd) {
+  case BWR:
+  case P_BWR:
+  case BWR8R:
+    // [0] data, [1] mask
+    mem[0] = (mem[0] & ~op[1]) | (op[0] & op[1]);
+    break;
+  case TWOADD8:
+  case P_2ADD8:
+  case TWOADDS8R:
+    mem[0] += op[0];
+    mem[1] += op[1];
+    break;
+  case ADD16:
+  case P_ADD16:
+  case ADDS16R:
+    mem[0] += op[0];
+    mem[1] += op[1] + (mem[0] < op[0]);
+    break;
+  case INC8:
+  case P_INC8:
+    mem[0]++;
+    break;
+  case XOR16:
+    mem[0] ^= op[0];
+    mem[1] ^= op[1];
+    break;
+  case OR16:
+    mem[0] |= op[0];
+    mem[1] |= op[1];
+    break;
+  case NOR16:
+    mem[0] = ~(mem[0] | op[0]);
+    mem[1] = ~(mem[1] | op[1]);
+    break;
+  case AND16:
+    mem[0] &= op[0];
+    mem[1] &= op[1];
+    break;
+  case NAND16:
+    mem[0] = ~(mem[0] & op[0]);
+    mem[1] = ~(mem[1] & op[1]);
+    break;
+  case CASGT8:
+    if ((int64_t)op[0] > (int64_t)mem[0])
+      mem[0] = op[0];
+    break;
+  case CASLT8:
+    if ((int64_t)op[0] < (int64_t)mem[0])
+      mem[0] = op[0];
+    break;
+  case CASGT16:
+    if ((int64_t)op[1] > (int64_t)mem[1]
+        || (op[1] == mem[1] && op[0] > mem[0])) {
+      mem[0] = op[0];
+      mem[1] = op[1];
+    }
+    break;
+  case CASLT16:
+    if ((int64_t)op[1] < (int64_t)mem[1]
+        || (op[1] == mem[1] && op[0] < mem[0])) {
+      mem[0] = op[0];
+      mem[1] = op[1];
+    }
+    break;
+  case CASEQ8:
+    // [0] compare, [1] swap
+    if (mem[0] == op[0])
+      mem[0] = op[1];
+    break;
+  case CASZERO16:
+    if (!mem[0] && !mem[1]) {
+      mem[0] = op[0];
+      mem[1] = op[1];
+    }
+    break;
+  case EQ8:
+    *af = (mem[0] == op[0]);
+    break;
+  case EQ16:
+    *af = (mem[0] == op[0] && mem[1] == op[1]);
+    break;
+  case SWAP16:
+    mem[0] = op[0];
+    mem[1] = op[1];
+    break;
+  default:
+    break;
+  }
+
+  if (mem[0] != orig[0] || mem[1] != orig[1])
+    this->write(addr, mem, sizeof(mem));
+
+  if (rsp_bytes) {
+    memset(rsp_payload, 0, rsp_bytes);
+    memcpy(rsp_payload, orig, (rsp_bytes < sizeof(orig)) ? rsp_bytes : sizeof(orig));
+  }
+}
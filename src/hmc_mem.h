@@ -0,0 +1,43 @@
+#ifndef _HMC_MEM_H_
+#define _HMC_MEM_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include "hmc_macros.h"
+#include "hmc_sim_t.h"
+
+/*
+ * Functional backing store of one vault. Memory is kept in pages, which are
+ * allocated (zeroed) by the first write to them, reading an untouched page
+ * returns zeros. With env HMCSIM_MEM_MMAP set, the address range of the cube is
+ * reserved as one anonymous mapping instead: the kernel does the lazy
+ * allocation and a page lookup is just an offset.
+ */
+#define HMC_MEM_PAGE_BITS   12
+#define HMC_MEM_PAGE_SIZE   (0x1u << HMC_MEM_PAGE_BITS)
+
+class hmc_mem {
+private:
+  std::unordered_map<uint64_t, uint8_t*> pages;
+  uint8_t *mapping;
+  uint64_t mapping_size;
+
+  uint8_t* page(uint64_t addr, bool alloc);
+  void read(uint64_t addr, void *data, unsigned bytes);
+  void write(uint64_t addr, const void *data, unsigned bytes);
+
+public:
+  explicit hmc_mem(uint64_t size);
+  ~hmc_mem(void);
+
+  /*
+   * Executes the request on the store. payload is the data of the request
+   * (between header and tail), rsp_payload receives rsp_bytes of response data
+   * and *af the atomic flag (EQ8, EQ16).
+   */
+  void process(hmc_rqst_t cmd, uint64_t addr,
+               const uint64_t *payload, unsigned payload_bytes,
+               uint64_t *rsp_payload, unsigned rsp_bytes, bool *af);
+};
+
+#endif /* #ifndef _HMC_MEM_H_ */
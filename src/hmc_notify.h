@@ -2,8 +2,129 @@
 #define _HMC_NOTIFY_H_
 
 #include "hmc_macros.h"
+#include <cstdint>
 #include <iostream>
 
+/*
+ * Children per notify level, may be raised at compile time. Up to 64 it is a
+ * single word, beyond a summary word keeps track of the non-empty words, such
+ * that finding the next set bit stays two ctz at most (up to 64 * 64 children).
+ */
+#ifndef HMC_NOTIFY_MAX_CHILDREN
+# define HMC_NOTIFY_MAX_CHILDREN  64
+#endif /* #ifndef HMC_NOTIFY_MAX_CHILDREN */
+#define HMC_NOTIFY_WORDS          ((HMC_NOTIFY_MAX_CHILDREN + 63) / 64)
+#define HMC_NOTIFY_NONE           (~0u)
+
+static_assert(HMC_NOTIFY_WORDS <= 64, "HMC_NOTIFY_MAX_CHILDREN: at most 4096");
+
+class hmc_notify_map {
+private:
+  uint64_t words[HMC_NOTIFY_WORDS];
+#if HMC_NOTIFY_WORDS > 1
+  uint64_t summary;
+#endif /* #if HMC_NOTIFY_WORDS > 1 */
+
+public:
+  hmc_notify_map(void)
+  {
+    this->clear();
+  }
+
+  ALWAYS_INLINE void clear(void)
+  {
+    for (unsigned w = 0; w < HMC_NOTIFY_WORDS; w++)
+      this->words[w] = 0;
+#if HMC_NOTIFY_WORDS > 1
+    this->summary = 0;
+#endif /* #if HMC_NOTIFY_WORDS > 1 */
+  }
+
+  ALWAYS_INLINE void fill(void)
+  {
+    for (unsigned w = 0; w < HMC_NOTIFY_WORDS; w++)
+      this->words[w] = ~0ull;
+#if HMC_NOTIFY_WORDS > 1
+    this->summary = (HMC_NOTIFY_WORDS == 64) ? ~0ull : ((0x1ull << HMC_NOTIFY_WORDS) - 1);
+#endif /* #if HMC_NOTIFY_WORDS > 1 */
+  }
+
+  ALWAYS_INLINE bool any(void) const
+  {
+#if HMC_NOTIFY_WORDS > 1
+    return this->summary != 0;
+#else
+    return this->words[0] != 0;
+#endif /* #if HMC_NOTIFY_WORDS > 1 */
+  }
+
+  ALWAYS_INLINE explicit operator bool(void) const
+  {
+    return this->any();
+  }
+
+  ALWAYS_INLINE bool test(unsigned id) const
+  {
+    return (this->words[id >> 6] >> (id & 63)) & 0x1;
+  }
+
+  ALWAYS_INLINE void set(unsigned id)
+  {
+    this->words[id >> 6] |= (0x1ull << (id & 63));
+#if HMC_NOTIFY_WORDS > 1
+    this->summary |= (0x1ull << (id >> 6));
+#endif /* #if HMC_NOTIFY_WORDS > 1 */
+  }
+
+  ALWAYS_INLINE void reset(unsigned id)
+  {
+    this->words[id >> 6] &= ~(0x1ull << (id & 63));
+#if HMC_NOTIFY_WORDS > 1
+    if (!this->words[id >> 6])
+      this->summary &= ~(0x1ull << (id >> 6));
+#endif /* #if HMC_NOTIFY_WORDS > 1 */
+  }
+
+  unsigned count(void) const
+  {
+    unsigned n = 0;
+    for (unsigned w = 0; w < HMC_NOTIFY_WORDS; w++)
+      n += __builtin_popcountll(this->words[w]);
+    return n;
+  }
+
+  // lowest set bit >= id, HMC_NOTIFY_NONE if there is none
+  ALWAYS_INLINE unsigned next(unsigned id) const
+  {
+    if (id >= HMC_NOTIFY_WORDS * 64)
+      return HMC_NOTIFY_NONE;
+    unsigned w = id >> 6;
+    uint64_t bits = this->words[w] & (~0ull << (id & 63));
+    if (bits)
+      return (w << 6) + __builtin_ctzll(bits);
+#if HMC_NOTIFY_WORDS > 1
+    uint64_t rest = (w + 1 < 64) ? (this->summary & (~0ull << (w + 1))) : 0;
+    if (rest) {
+      w = __builtin_ctzll(rest);
+      return (w << 6) + __builtin_ctzll(this->words[w]);
+    }
+#endif /* #if HMC_NOTIFY_WORDS > 1 */
+    return HMC_NOTIFY_NONE;
+  }
+
+  ALWAYS_INLINE unsigned first(void) const
+  {
+    return this->next(0);
+  }
+
+  // lowest set bit >= id, wrapping around to the lowest set bit overall (round robin)
+  ALWAYS_INLINE unsigned next_wrap(unsigned id) const
+  {
+    unsigned i = this->next(id);
+    return (i != HMC_NOTIFY_NONE) ? i : this->first();
+  }
+};
+
 class hmc_notify_cl {
 public:
   hmc_notify_cl(void) {}
@@ -17,28 +138,36 @@ class hmc_notify {
 private:
   // current
   unsigned id;
-  unsigned notifier;
+  hmc_notify_map notifier;
 
   // upwards
   hmc_notify* up;
   hmc_notify_cl* notify;
   unsigned ncase;
+#ifdef HMC_USES_THREADS
+  // children are clocked concurrently -> the owner resyncs the bits afterwards
+  bool deferred;
+#endif /* #ifdef HMC_USES_THREADS */
 
 public:
   hmc_notify(void) :
     id(0),
-    notifier(0),
     up(nullptr),
     notify(nullptr),
     ncase(0)
+#ifdef HMC_USES_THREADS
+    , deferred(false)
+#endif /* #ifdef HMC_USES_THREADS */
   {}
 
   hmc_notify(unsigned id, hmc_notify *up, hmc_notify_cl *notify) :
     id(id),
-    notifier(0),
     up(up),
     notify(notify),
     ncase(0)
+#ifdef HMC_USES_THREADS
+    , deferred(false)
+#endif /* #ifdef HMC_USES_THREADS */
   {}
 
   ~hmc_notify(void)
@@ -52,10 +181,21 @@ public:
       this->ncase = ncase;
   }
 
+#ifdef HMC_USES_THREADS
+  ALWAYS_INLINE void set_deferred(bool deferred)
+  {
+    this->deferred = deferred;
+  }
+#endif /* #ifdef HMC_USES_THREADS */
+
   void notify_add(unsigned down_id)
   {
-    if (!(this->notifier & (0x1 << down_id))) {
-      this->notifier |= (0x1 << down_id);
+#ifdef HMC_USES_THREADS
+    if (this->deferred)
+      return;
+#endif /* #ifdef HMC_USES_THREADS */
+    if (!this->notifier.test(down_id)) {
+      this->notifier.set(down_id);
       if (this->up != nullptr)
         this->up->notify_add(this->id);
     }
@@ -63,17 +203,22 @@ public:
 
   void notify_del(unsigned down_id)
   {
-    this->notifier &= ~(0x1 << down_id);
+#ifdef HMC_USES_THREADS
+    if (this->deferred)
+      return;
+#endif /* #ifdef HMC_USES_THREADS */
+    this->notifier.reset(down_id);
     if (this->up != nullptr && this->notify->notify_up(this->ncase))
       this->up->notify_del(this->id);
   }
 
-  ALWAYS_INLINE unsigned get_notification(void)
+  ALWAYS_INLINE const hmc_notify_map& get_notification(void)
   {
 #ifdef HMC_USES_NOTIFY
-     return this->notifier;
+    return this->notifier;
 #else
-    return ~0x0;
+    static const hmc_notify_map all = []() { hmc_notify_map m; m.fill(); return m; }();
+    return all;
 #endif /* #ifdef HMC_USES_NOTIFY */
   }
 };
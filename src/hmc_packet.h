@@ -4,6 +4,24 @@
 #include <cstdint>
 //#include "../include/hmc_sim_macros.h"
 
+/*
+ * Decoded once, as the packet enters the simulator (hmc_sim: requests, vault:
+ * responses) and carried along next to it within its pool slot (see
+ * hmc_pool::meta()). Routing reads its fields instead of decoding the header
+ * at every hop.
+ */
+struct hmc_packet_meta {
+  uint64_t injected;    // cycle the request entered the simulator (responses: of their request)
+  uint8_t hops;         // routed by connections so far
+  uint8_t cub;          // destination: requests the addressed cube, responses the cube of the slid
+  uint8_t quad;         // destination quad: addressed or the one of the slid
+  uint8_t vault;        // within quad (requests only)
+  uint8_t bank;         // requests only
+  uint8_t slid;
+  uint8_t exit_cub;     // multipath: cube, which chose exit_quad to leave towards cub (~0: none yet)
+  uint8_t exit_quad;
+};
+
 #ifdef HMC_HAS_LOGIC
 /* specified in the TAIL of the packet */
 /* [22:22] specify if from logic or host */
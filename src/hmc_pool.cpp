@@ -0,0 +1,51 @@
+#include <cstring>
+#include "hmc_pool.h"
+
+hmc_pool::hmc_pool(bool size_classes) :
+  size_classes(size_classes)
+#ifdef HMC_USES_THREADS
+  , concurrent(false)
+#endif /* #ifdef HMC_USES_THREADS */
+{
+  this->freelist.fill(nullptr);
+  memset(this->stats.data(), 0, sizeof(struct hmc_pool_stats) * this->stats.size());
+}
+
+hmc_pool::~hmc_pool(void)
+{
+  for (std::list<char*>::iterator it = this->slabs.begin(); it != this->slabs.end(); ++it)
+    delete[] *it;
+}
+
+void hmc_pool::refill(unsigned cls)
+{
+  unsigned slotsize = sizeof(hmc_pool_slot) + cls * (FLIT_WIDTH / 8);
+  char *slab = new char[slotsize * HMC_POOL_SLAB_SLOTS];
+  this->slabs.push_back(slab);
+  this->stats[cls].slabs++;
+
+  // chain slots in address order, therewith they are handed out sequentially
+  hmc_pool_slot *next = this->freelist[cls];
+  for (unsigned i = HMC_POOL_SLAB_SLOTS; i-- > 0; ) {
+    hmc_pool_slot *slot = (hmc_pool_slot*)&slab[i * slotsize];
+    slot->next = next;
+    next = slot;
+  }
+  this->freelist[cls] = next;
+}
+
+void hmc_pool::get_stats(unsigned flits, struct hmc_pool_stats *stats)
+{
+  assert(flits <= HMC_MAX_FLITS_PER_PACKET);
+  if (flits) {
+    *stats = this->stats[(this->size_classes) ? flits : HMC_MAX_FLITS_PER_PACKET];
+    return;
+  }
+
+  *stats = this->stats[0];
+  for (unsigned i = 1; i < this->stats.size(); i++) {
+    stats->hits += this->stats[i].hits;
+    stats->misses += this->stats[i].misses;
+    stats->slabs += this->stats[i].slabs;
+  }
+}
@@ -0,0 +1,135 @@
+#ifndef _HMC_POOL_H_
+#define _HMC_POOL_H_
+
+#include <cassert>
+#include <cstdint>
+#include <array>
+#include <list>
+#ifdef HMC_USES_THREADS
+# include <atomic>
+# include <thread>
+#endif /* #ifdef HMC_USES_THREADS */
+#include "config.h"
+#include "hmc_macros.h"
+#include "hmc_packet.h"
+
+/*
+ * Every packet, which is in flight within the simulator, is placed into a slot of
+ * this pool. Slots are grouped into size classes (one per flit count) and each
+ * class is refilled with slabs of HMC_POOL_SLAB_SLOTS slots. Released slots are
+ * put back onto the free list of their class, therewith the hot path does not
+ * touch the general heap as soon as the pool is warmed up. The slot also holds
+ * the packet's decoded routing fields (struct hmc_packet_meta).
+ */
+#define HMC_POOL_SLAB_SLOTS     256
+
+struct hmc_pool_stats {
+  uint64_t hits;       // served from the free list
+  uint64_t misses;     // a new slab had to be allocated
+  uint64_t in_use;
+  uint64_t high_water;
+  uint64_t slabs;
+};
+
+class hmc_pool {
+private:
+  // precedes every packet, 32 byte -> packet stays 16 byte (1 FLIT) aligned
+  struct hmc_pool_slot {
+    hmc_pool_slot *next;
+    unsigned cls;
+    struct hmc_packet_meta meta;
+  };
+  static_assert(!(sizeof(hmc_pool_slot) % (FLIT_WIDTH / 8)), "hmc_pool_slot breaks the FLIT alignment");
+
+  bool size_classes;
+  std::array<hmc_pool_slot*, HMC_MAX_FLITS_PER_PACKET + 1> freelist;
+  // [0] accounts in_use and high_water over all classes
+  std::array<struct hmc_pool_stats, HMC_MAX_FLITS_PER_PACKET + 1> stats;
+  std::list<char*> slabs;
+#ifdef HMC_USES_THREADS
+  // only taken, if cubes are clocked by several threads
+  bool concurrent;
+  std::atomic_flag locked = ATOMIC_FLAG_INIT;
+#endif /* #ifdef HMC_USES_THREADS */
+
+  void refill(unsigned cls);
+
+  ALWAYS_INLINE void lock(void)
+  {
+#ifdef HMC_USES_THREADS
+    if (this->concurrent) {
+      while (this->locked.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+    }
+#endif /* #ifdef HMC_USES_THREADS */
+  }
+  ALWAYS_INLINE void unlock(void)
+  {
+#ifdef HMC_USES_THREADS
+    if (this->concurrent)
+      this->locked.clear(std::memory_order_release);
+#endif /* #ifdef HMC_USES_THREADS */
+  }
+
+public:
+  explicit hmc_pool(bool size_classes = true);
+  ~hmc_pool(void);
+
+  ALWAYS_INLINE char* alloc(unsigned flits)
+  {
+    assert(flits && flits <= HMC_MAX_FLITS_PER_PACKET);
+    unsigned cls = (this->size_classes) ? flits : HMC_MAX_FLITS_PER_PACKET;
+    struct hmc_pool_stats *st = &this->stats[cls];
+
+    this->lock();
+    if (__builtin_expect(this->freelist[cls] == nullptr, 0)) {
+      this->refill(cls);
+      st->misses++;
+    }
+    else
+      st->hits++;
+
+    hmc_pool_slot *slot = this->freelist[cls];
+    this->freelist[cls] = slot->next;
+    slot->cls = cls;
+
+    if (++st->in_use > st->high_water)
+      st->high_water = st->in_use;
+    if (++this->stats[0].in_use > this->stats[0].high_water)
+      this->stats[0].high_water = this->stats[0].in_use;
+    this->unlock();
+
+    return (char*)(slot + 1);
+  }
+
+  ALWAYS_INLINE void release(char *packet)
+  {
+    hmc_pool_slot *slot = (hmc_pool_slot*)packet - 1;
+    unsigned cls = slot->cls;
+    this->lock();
+    slot->next = this->freelist[cls];
+    this->freelist[cls] = slot;
+
+    this->stats[cls].in_use--;
+    this->stats[0].in_use--;
+    this->unlock();
+  }
+
+  // valid for packets of the pool only, filled in by whoever injects the packet
+  static ALWAYS_INLINE struct hmc_packet_meta* meta(char *packet)
+  {
+    return &((hmc_pool_slot*)packet - 1)->meta;
+  }
+
+#ifdef HMC_USES_THREADS
+  ALWAYS_INLINE void set_concurrent(bool concurrent)
+  {
+    this->concurrent = concurrent;
+  }
+#endif /* #ifdef HMC_USES_THREADS */
+
+  // flits == 0 -> summary over all size classes
+  void get_stats(unsigned flits, struct hmc_pool_stats *stats);
+};
+
+#endif /* #ifndef _HMC_POOL_H_ */
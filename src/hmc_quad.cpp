@@ -8,6 +8,7 @@
 #endif
 #include "hmc_notify.h"
 #include "hmc_link.h"
+#include "hmc_link_queue.h"
 
 hmc_quad::hmc_quad(unsigned id, hmc_conn_part *conn, unsigned num_ranks, hmc_notify *notify,
                    hmc_cube *cube, uint64_t *clk) :
@@ -28,6 +29,10 @@ hmc_quad::hmc_quad(unsigned id, hmc_conn_part *conn, unsigned num_ranks, hmc_not
      * Vault: bi-directional    80Gbit/s (10GB/s) (bitwidth: 32bits * bitrate: 2.5Gbit/s)
      */
     linkend0->adjust_both_linkends(32, 2.5f, FLIT_WIDTH * RETRY_BUFFER_FLITS);
+#ifdef HMC_USES_THREADS
+    this->vault_tx[i] = linkend1->get_tx();
+    this->vault_tx[i]->set_staged();
+#endif /* #ifdef HMC_USES_THREADS */
     this->link_garbage.push_back(linkend0);
     this->link_garbage.push_back(linkend1);
   }
@@ -44,11 +49,8 @@ hmc_quad::~hmc_quad(void)
 void hmc_quad::clock(void)
 {
 #ifdef HMC_USES_NOTIFY
-  unsigned notifymap = this->vault_notify.get_notification();
-  for (unsigned i, lid = i = __builtin_ctzl(notifymap);
-       notifymap >>= lid;
-       lid = __builtin_ctzl(notifymap >>= 1),
-       i += (lid + 1))
+  hmc_notify_map notifymap = this->vault_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
 #else
   for (unsigned i = 0; i < HMC_NUM_VAULTS / HMC_NUM_QUADS; i++)
 #endif /* #ifdef HMC_USES_NOTIFY */
@@ -57,6 +59,79 @@ void hmc_quad::clock(void)
   }
 }
 
+uint64_t hmc_quad::next_event(void)
+{
+  uint64_t next = HMC_NO_EVENT;
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->vault_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_VAULTS / HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    uint64_t ev = this->vaults[i]->next_event();
+    if (ev < next)
+      next = ev;
+    if (next == 1)
+      return next;
+  }
+  return next;
+}
+
+void hmc_quad::fast_forward(uint64_t cycles)
+{
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->vault_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_VAULTS / HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->vaults[i]->fast_forward(cycles);
+  }
+}
+
+#ifdef HMC_USES_THREADS
+void hmc_quad::stage_vaults(std::vector<hmc_vault_task> *tasks)
+{
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->vault_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < HMC_NUM_VAULTS / HMC_NUM_QUADS; i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->staged_vaults.set(i);
+    this->vault_tx[i]->stage_begin();
+    tasks->push_back(std::make_pair(this, i));
+  }
+  this->vault_notify.set_deferred(true);
+}
+
+void hmc_quad::clock_vault(unsigned i)
+{
+  this->vaults[i]->clock();
+}
+
+// in the order of the vaults -> deterministic
+void hmc_quad::commit_vaults(void)
+{
+  this->vault_notify.set_deferred(false);
+  hmc_notify_map notifymap = this->staged_vaults;
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+  {
+    this->vault_tx[i]->commit();
+#ifdef HMC_USES_NOTIFY
+    if (this->vaults[i]->get_notification())
+      this->vault_notify.notify_add(i);
+    else if (this->vault_notify.get_notification().test(i))
+      this->vault_notify.notify_del(i);
+#endif /* #ifdef HMC_USES_NOTIFY */
+  }
+  this->staged_vaults.clear();
+}
+#endif /* #ifdef HMC_USES_THREADS */
+
 bool hmc_quad::notify_up(unsigned id)
 {
 #ifdef HMC_USES_NOTIFY
@@ -66,3 +141,10 @@ bool hmc_quad::notify_up(unsigned id)
 #endif /* #ifdef HMC_USES_NOTIFY */
 }
 
+#ifdef HMC_USES_COUNTERS
+void hmc_quad::collect_counters(hmc_counters *ctrs, const std::string &prefix)
+{
+  for (unsigned i = 0; i < HMC_NUM_VAULTS / HMC_NUM_QUADS; i++)
+    this->vaults[i]->collect_counters(ctrs, prefix + ".vault" + std::to_string(i));
+}
+#endif /* #ifdef HMC_USES_COUNTERS */
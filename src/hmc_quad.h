@@ -1,11 +1,21 @@
 #ifndef _HMC_QUAD_H_
 #define _HMC_QUAD_H_
 
+#include <cstdint>
 #include <list>
 #include <array>
+#ifdef HMC_USES_THREADS
+# include <utility>
+# include <vector>
+#endif /* #ifdef HMC_USES_THREADS */
+#ifdef HMC_USES_COUNTERS
+# include <string>
+#endif /* #ifdef HMC_USES_COUNTERS */
 #include "config.h"
 #include "hmc_notify.h"
 
+static_assert(HMC_NUM_VAULTS / HMC_NUM_QUADS <= HMC_NOTIFY_MAX_CHILDREN, "vaults per quad exceed HMC_NOTIFY_MAX_CHILDREN");
+
 #ifdef HMC_USES_BOBSIM
 class hmc_bobsim;
 #else
@@ -14,6 +24,14 @@ class hmc_vault;
 class hmc_cube;
 class hmc_conn_part;
 class hmc_link;
+class hmc_link_queue;
+#ifdef HMC_USES_COUNTERS
+class hmc_counters;
+#endif /* #ifdef HMC_USES_COUNTERS */
+#ifdef HMC_USES_THREADS
+class hmc_quad;
+typedef std::pair<hmc_quad*, unsigned> hmc_vault_task;
+#endif /* #ifdef HMC_USES_THREADS */
 
 class hmc_quad : private hmc_notify_cl {
 private:
@@ -24,6 +42,11 @@ private:
   std::array<hmc_vault*, HMC_NUM_VAULTS / HMC_NUM_QUADS> vaults;
 #endif /* #ifdef HMC_USES_BOBSIM */
   std::list<hmc_link*> link_garbage;
+#ifdef HMC_USES_THREADS
+  // vault -> conn queues, staged while the vaults are clocked concurrently
+  std::array<hmc_link_queue*, HMC_NUM_VAULTS / HMC_NUM_QUADS> vault_tx;
+  hmc_notify_map staged_vaults;
+#endif /* #ifdef HMC_USES_THREADS */
 
   bool notify_up(unsigned id);
 
@@ -33,6 +56,23 @@ public:
   virtual ~hmc_quad(void);
 
   void clock(void);
+  uint64_t next_event(void);
+  void fast_forward(uint64_t cycles);
+#ifdef HMC_USES_COUNTERS
+  void collect_counters(hmc_counters *ctrs, const std::string &prefix);
+#endif /* #ifdef HMC_USES_COUNTERS */
+
+#ifdef HMC_USES_THREADS
+  /*
+   * Concurrent clocking of the vaults: stage_vaults() hands out the vaults to be
+   * clocked this cycle, each one may run on another thread by clock_vault().
+   * Meanwhile nothing leaves a vault: its responses are staged and the
+   * vault_notify bits are resynced by commit_vaults(), which runs single threaded.
+   */
+  void stage_vaults(std::vector<hmc_vault_task> *tasks);
+  void clock_vault(unsigned i);
+  void commit_vaults(void);
+#endif /* #ifdef HMC_USES_THREADS */
 };
 
 #endif /* #ifndef _HMC_QUAD_H_ */
@@ -0,0 +1,34 @@
+#ifndef _HMC_RING_H_
+#define _HMC_RING_H_
+
+#include "hmc_macros.h"
+
+/*
+ * Helpers for the contiguous power-of-two ring buffers of the link queues and
+ * fifos. The entries are kept as structure of arrays by the owner, which tracks
+ * head, size and mask itself. A ring only grows during warm up, afterwards
+ * clocking a link does not allocate any more.
+ */
+#define HMC_RING_INIT_SLOTS     8
+
+ALWAYS_INLINE unsigned hmc_ring_roundup(unsigned slots)
+{
+  unsigned cap = HMC_RING_INIT_SLOTS;
+  while (cap < slots)
+    cap <<= 1;
+  return cap;
+}
+
+// moves the 'size' entries starting at 'head' into a new array of 'newcap' slots (linearized -> head becomes 0)
+template <typename T>
+static inline void hmc_ring_relocate(T *&field, unsigned head, unsigned size,
+                                     unsigned mask, unsigned newcap)
+{
+  T *n = new T[newcap];
+  for (unsigned i = 0; i < size; i++)
+    n[i] = field[(head + i) & mask];
+  delete[] field;
+  field = n;
+}
+
+#endif /* #ifndef _HMC_RING_H_ */
@@ -1,11 +1,18 @@
 #include <iostream>
+#include <vector>
 #include "hmc_route.h"
 #include "hmc_connection.h"
 #include "hmc_cube.h"
 
 hmc_route::hmc_route(std::map<unsigned, hmc_cube*> *cubes, unsigned numcubes) :
-  cubes(cubes)
+  cubes(cubes),
+  numcubes(numcubes),
+  multipath(HMC_MULTIPATH_FIRST),
+  exits(numcubes, 0x0),
+  exits_rr(numcubes, 0)
 {
+  this->slidToCube.fill(std::make_pair(0, 0));
+
   this->link_graph = new hmc_graph_t[numcubes];
   memset(this->link_graph, 0, sizeof(hmc_graph_t) * numcubes);
 
@@ -22,6 +29,7 @@ hmc_route::~hmc_route(void)
 
 void hmc_route::set_slid(unsigned slid, unsigned cubId, unsigned quadId)
 {
+  assert(slid < HMC_MAX_SLIDS);
   std::cout << "HMC_ROUTE: slid : " << slid << " cub " << cubId << " quad " << quadId << std::endl;
   this->slidToCube[slid] = std::make_pair(cubId, quadId);
 }
@@ -64,111 +72,77 @@ void hmc_route::hmc_routing_tables_visualize(void)
   }
 }
 
-bool hmc_route::hmc_insert_route(hmc_cube *cube, unsigned cube_endId, hmc_route_t *route)
+void hmc_route::hmc_routing_clear(void)
 {
-  hmc_route_t **cur = &cube->get_routingtbl()[ cube_endId ];
-  hmc_route_t **pre = cur;
-  while ((*cur) != nullptr) {
-    if ((*cur)->next_dev == route->next_dev) {
-      if (route->hops >= (*cur)->hops) {
-        return false;
-      }
-      else {
-        route->next = (*cur)->next;
-        delete *cur;
-        (*cur) = route;
-        return true;
-      }
+  for (unsigned i = 0; i < this->numcubes; i++) {
+    hmc_route_t *cur = this->tbl[ i ];
+    while (cur != nullptr) {
+      hmc_route_t *pre = cur;
+      cur = cur->next;
+      delete pre;
     }
-    pre = cur;
-    cur = &(*cur)->next;
-  }
-  if ((*pre) == nullptr || pre == cur) {
-    route->next = (*cur);
-    (*pre) = route;
-  }
-  else {
-    route->next = (*cur);
-    (*pre)->next = route;
+    this->tbl[ i ] = nullptr;
   }
-  return true;
 }
 
-
-int hmc_route::hmc_graph_search(unsigned start_id, unsigned i, unsigned first_hop, unsigned end_id, unsigned hop)
+/*
+ * Shortest paths by a breadth first search from every destination, the links
+ * are bidirectional. Each cube keeps all neighbours, which are one hop closer
+ * to the destination, as equal cost next hops (ascending by id, the first one
+ * is the default route). Directly attached destinations have the direct link
+ * only.
+ */
+// ToDo: load via JTAG!
+void hmc_route::hmc_routing_tables_update(void)
 {
-  if (i == end_id) {
-    hmc_route_t *route = new hmc_route_t[1];
-    route->hops = hop - 1;
-    route->next_dev = first_hop;
-    route->links = &(*this->cubes)[start_id]->get_partial_link_graph(first_hop)->links;             // fixME
-    if (!this->hmc_insert_route((*this->cubes)[start_id], end_id, route))
-      delete[] route;
-//		printf("  found -> %d via %d to %d hops: %d  first link: %d (links: %d)\n", start_id, first_hop, end_id, hop - 1,
-//						__builtin_ctz( hmc->link_graph[ start_id ][ first_hop ].links ), hmc_utils_popcount( sizeof(unsigned), hmc->link_graph[ start_id ][ first_hop ].links ) );
-    return 1;
-  }
-  if (start_id == i && hop > 0)
-    return 0;
+  unsigned numcubes = this->cubes->size();
+  std::vector<unsigned> dist(numcubes * numcubes, ~0x0u);
+  std::vector<unsigned> queue(numcubes);
 
-  for (unsigned j = 0; j < this->cubes->size(); j++) {
-    if (i != j && (*this->cubes)[i]->get_partial_link_graph(j)->links &&
-        !(*this->cubes)[i]->get_partial_link_graph(j)->visited) {
-      first_hop = (!hop) ? j : first_hop;
-//			printf("checking  (h%d) %d -- %d --> %d  (cur %d)\n", hop, start_id, first_hop, j, i );
-      (*this->cubes)[i]->get_partial_link_graph(j)->visited = 1;
-      (*this->cubes)[j]->get_partial_link_graph(i)->visited = 1;
-      /*unsigned ret =*/ this->hmc_graph_search(start_id, j, first_hop, end_id, hop + 1);
-      (*this->cubes)[i]->get_partial_link_graph(j)->visited = 0;
-      (*this->cubes)[j]->get_partial_link_graph(i)->visited = 0;
-//			if( ret )  // commented -> search for all
-//				return 1;
+  for (unsigned j = 0; j < numcubes; j++) {
+    unsigned *d = &dist[j * numcubes];
+    unsigned head = 0, tail = 0;
+    d[j] = 0;
+    queue[tail++] = j;
+    while (head < tail) {
+      unsigned n = queue[head++];
+      for (unsigned m = 0; m < numcubes; m++) {
+        if (d[m] == ~0x0u && (*this->cubes)[n]->get_partial_link_graph(m)->links) {
+          d[m] = d[n] + 1;
+          queue[tail++] = m;
+        }
+      }
     }
   }
-  return 0;
-}
 
-// ToDo: load via JTAG!
-void hmc_route::hmc_routing_tables_update(void)
-{
-  unsigned numcubes = this->cubes->size();
   for (unsigned i = 0; i < numcubes; i++) {
+    hmc_cube *cube = (*this->cubes)[i];
+    cube->hmc_routing_clear();
     for (unsigned j = 0; j < numcubes; j++) {
-      if (i != j)
-        this->hmc_graph_search(i, i, i, j, 0);                           // ToDo: check in which direction routing is possible! NON SRC MODE <-> PASSTHROUGH
+      unsigned hops = dist[j * numcubes + i];
+      if (i == j || hops == ~0x0u)
+        continue;
 
-      // remove routing entries, if directly attached
-      hmc_route_t *cur = (*this->cubes)[i]->get_routingtbl()[j];
-      while (cur != NULL) {
-        if (cur->next_dev == j)
-          break;
-        cur = cur->next;
-      }
-      if (cur != NULL) {
-        hmc_route_t *tmp = (*this->cubes)[i]->get_routingtbl()[j];
-        while (tmp != NULL) {
-          hmc_route_t *next = tmp->next;
-          if (tmp != cur)
-            delete tmp;
-          tmp = next;
-        }
-        (*this->cubes)[i]->get_routingtbl()[j] = cur;
-        cur->next = NULL;
+      hmc_route_t **last = &cube->get_routingtbl()[j];
+      for (unsigned n = 0; n < numcubes; n++) {
+        struct hmc_graph_t *graph = cube->get_partial_link_graph(n);
+        if (n == i || !graph->links || dist[j * numcubes + n] != hops - 1)
+          continue;
+        hmc_route_t *route = new hmc_route_t;
+        route->next_dev = n;
+        route->hops = hops - 1;
+        route->links = &graph->links;
+        route->next = nullptr;
+        *last = route;
+        last = &route->next;
       }
     }
-    // sort by hops?
+    cube->hmc_routing_flatten();
   }
 }
 
 void hmc_route::hmc_routing_cleanup(void)
 {
-  for (unsigned i = 0; i < this->cubes->size(); i++) {
-    hmc_route_t *cur = this->tbl[ i ];
-    while (cur != NULL) {
-      hmc_route_t *pre = cur;
-      cur = cur->next;
-      delete[] pre;
-    }
-  }
+  this->hmc_routing_clear();
   delete[] this->tbl;
 }
@@ -1,16 +1,27 @@
 #ifndef _HMC_ROUTE_H_
 #define _HMC_ROUTE_H_
 
+#include <array>
 #include <cassert>
 #include <cstring>
 #include <map>
+#include <utility>
+#include <vector>
+#include "config.h"
 #include "hmc_macros.h"
 
 class hmc_cube;
 
+// choice among the links towards the next cube(s), if there are several (env HMCSIM_MULTIPATH)
+enum hmc_multipath {
+  HMC_MULTIPATH_FIRST = 0x0,  // first link of the first route only
+  HMC_MULTIPATH_RR    = 0x1,  // round robin, per destination cube
+  HMC_MULTIPATH_HASH  = 0x2,  // by address (responses: by tag)
+  HMC_MULTIPATH_LEAST = 0x3   // least occupied link
+};
+
 struct hmc_graph_t {
     unsigned links;
-    unsigned visited;
 };
 
 class hmc_route_t {
@@ -23,13 +34,20 @@ public:
 
 class hmc_route {
   std::map<unsigned, hmc_cube*>* cubes;
-  std::map<unsigned, std::pair<unsigned,unsigned> > slidToCube;
+  unsigned numcubes;
+  std::array<std::pair<unsigned,unsigned>, HMC_MAX_SLIDS> slidToCube;
 
   hmc_route_t ** tbl;
   struct hmc_graph_t* link_graph;
 
-  bool hmc_insert_route(hmc_cube *cube, unsigned cube_endId, hmc_route_t *route);
-  int hmc_graph_search(unsigned start_id, unsigned i, unsigned first_hop, unsigned end_id, unsigned hop);
+protected:
+  enum hmc_multipath multipath;
+  // by destination cube: quads, whose link leads to a next hop of a shortest route
+  std::vector<uint8_t> exits;
+  std::vector<unsigned> exits_rr;
+
+private:
+
   void hmc_routing_cleanup(void);
 
 public:
@@ -37,10 +55,16 @@ public:
   ~hmc_route(void);
 
   void hmc_routing_tables_visualize(void);
+  // recomputes the routing tables of all cubes, see hmc_sim::hmc_routing_finalize()
   void hmc_routing_tables_update(void);
+  void hmc_routing_clear(void);
 
   void set_slid(unsigned slid, unsigned cubId, unsigned quadId);
 
+  ALWAYS_INLINE unsigned get_numcubes(void)
+  {
+    return this->numcubes;
+  }
   ALWAYS_INLINE hmc_route_t** get_routingtbl(void)
   {
     return this->tbl;
@@ -52,15 +76,26 @@ public:
 
   ALWAYS_INLINE unsigned slid_to_cubid(unsigned slid)
   {
+    assert(slid < HMC_MAX_SLIDS);
     return this->slidToCube[slid].first;
   }
 
   ALWAYS_INLINE unsigned slid_to_quadid(unsigned slid)
   {
+    assert(slid < HMC_MAX_SLIDS);
     return this->slidToCube[slid].second;
   }
 
   unsigned ext_routing(unsigned destCubId, unsigned curQuadId);
+
+  ALWAYS_INLINE enum hmc_multipath get_multipath(void)
+  {
+    return this->multipath;
+  }
+  ALWAYS_INLINE unsigned get_exits(unsigned destCubId)
+  {
+    return this->exits[destCubId];
+  }
 };
 
 #endif /* #ifndef _HMC_ROUTE_H_ */
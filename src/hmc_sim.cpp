@@ -1,5 +1,8 @@
 #include <iostream>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include "hmc_cmd.h"
 #include "hmc_cube.h"
 #include "hmc_sim.h"
 #include "hmc_link.h"
@@ -21,11 +24,24 @@ hmc_sim::hmc_sim(unsigned num_hmcs, unsigned num_slids,
                  unsigned quadbus_bitwidth, float quadbus_bitrate) :
   hmc_notify_cl(),
   clk(0),
+  pool(),
   cubes_notify(0, nullptr, this),
   slidnotify(),
   slidbufnotify(),
   num_slids(num_slids),
-  num_links(num_links)
+  num_links(num_links),
+  routing_dirty(false)
+#ifdef HMC_USES_THREADS
+  , threads(nullptr)
+#endif /* #ifdef HMC_USES_THREADS */
+#ifdef HMC_USES_COUNTERS
+  , counters_json(false),
+  counters_interval(0),
+  counters_next(~0ULL)
+#endif /* #ifdef HMC_USES_COUNTERS */
+#ifdef HMC_USES_LATENCY
+  , latency(new hmc_latency())
+#endif /* #ifdef HMC_USES_LATENCY */
 {
   if ((num_hmcs > HMC_MAX_DEVS) || (!num_hmcs)) {
     std::cerr << "INSUFFICIENT NUMBER DEVICES: between 1 to " << HMC_MAX_DEVS << " (" << num_hmcs << ")" << std::endl;
@@ -54,16 +70,72 @@ hmc_sim::hmc_sim(unsigned num_hmcs, unsigned num_slids,
     std::cerr << "INSUFFICIENT AMOUNT CAPACITY: between " << HMC_MIN_CAPACITY << " to " << HMC_MAX_CAPACITY << " (" << capacity << ")" << std::endl;
     throw false;
   }
+  this->slids.fill(nullptr);
 
+#ifdef HMC_USES_THREADS
+  // cubes are not hooked into cubes_notify, as it would be written concurrently
+  hmc_notify *cube_notify = nullptr;
+#else
+  hmc_notify *cube_notify = &this->cubes_notify;
+#endif /* #ifdef HMC_USES_THREADS */
   for (unsigned i = 0; i < num_hmcs; i++) {
-    this->cubes[i] = new hmc_cube(i, &this->cubes_notify, quadbus_bitwidth, quadbus_bitrate, capacity, &this->cubes, num_hmcs, &this->clk);
+    this->cubes[i] = new hmc_cube(i, cube_notify, quadbus_bitwidth, quadbus_bitrate, capacity, &this->cubes, num_hmcs, &this->clk, &this->pool);
     this->jtags[i] = new hmc_jtag(this->cubes[i]);
   }
 
+#ifdef HMC_USES_THREADS
+  unsigned num_threads = std::thread::hardware_concurrency();
+  char *threadsEnv = getenv("HMCSIM_THREADS");
+  if (threadsEnv != nullptr) {
+    char *end;
+    num_threads = strtoul(threadsEnv, &end, 10);
+    if (*end != '\0' || !num_threads) {
+      std::cerr << "ERROR: env HMCSIM_THREADS has wrong value! " << threadsEnv << ", choose 1 or more" << std::endl;
+      throw false;
+    }
+  }
+  if (num_threads > num_hmcs * HMC_NUM_VAULTS)
+    num_threads = num_hmcs * HMC_NUM_VAULTS;
+  if (!num_threads)
+    num_threads = 1;
+
+  for (unsigned i = 0; i < num_hmcs; i++)
+    this->cube_tasks.push_back(this->cubes[i]);
+  this->cube_task = [this](unsigned i) {
+                      this->cube_tasks[i]->clock_conn();
+                    };
+  this->vault_tasks.reserve(num_hmcs * HMC_NUM_VAULTS);
+  this->vault_task = [this](unsigned i) {
+                       this->vault_tasks[i].first->clock_vault(this->vault_tasks[i].second);
+                     };
+  this->threads = new hmc_thread_pool(num_threads);
+  this->pool.set_concurrent(num_threads > 1);
+#endif /* #ifdef HMC_USES_THREADS */
+
 #ifdef HMC_LOGGING
   hmc_trace::trace_setup();
 #endif /* #ifdef HMC_LOGGING */
 
+#ifdef HMC_USES_COUNTERS
+  char *ctrsEnv = getenv("HMCSIM_COUNTERS_FILE");
+  if (ctrsEnv != nullptr) {
+    uint64_t interval = 0;
+    char *intervalEnv = getenv("HMCSIM_COUNTERS_INTERVAL");
+    if (intervalEnv != nullptr) {
+      char *end;
+      interval = strtoull(intervalEnv, &end, 10);
+      if (*end != '\0') {
+        std::cerr << "ERROR: env HMCSIM_COUNTERS_INTERVAL has wrong value! " << intervalEnv << std::endl;
+        throw false;
+      }
+    }
+    std::string file(ctrsEnv);
+    bool json = file.size() >= 5 && !file.compare(file.size() - 5, 5, ".json");
+    if (!this->hmc_dump_counters(ctrsEnv, interval, json))
+      throw false;
+  }
+#endif /* #ifdef HMC_USES_COUNTERS */
+
   // set up the graph after everything else was set up!
 #ifdef HMC_USES_GRAPHVIZ
   hmc_graphviz graph(this);
@@ -72,9 +144,21 @@ hmc_sim::hmc_sim(unsigned num_hmcs, unsigned num_slids,
 
 hmc_sim::~hmc_sim(void)
 {
+#ifdef HMC_USES_COUNTERS
+  if (this->counters_file.is_open()) {
+    this->dump_counters();
+    this->counters_file.close();
+  }
+#endif /* #ifdef HMC_USES_COUNTERS */
+#ifdef HMC_USES_LATENCY
+  delete this->latency;
+#endif /* #ifdef HMC_USES_LATENCY */
 #ifdef HMC_LOGGING
   hmc_trace::trace_cleanup();
 #endif /* #ifdef HMC_LOGGING */
+#ifdef HMC_USES_THREADS
+  delete this->threads;
+#endif /* #ifdef HMC_USES_THREADS */
 
   unsigned i = 0;
   for (std::map<unsigned, hmc_cube*>::iterator it = this->cubes.begin(); it != this->cubes.end(); ++it) {
@@ -129,14 +213,44 @@ bool hmc_sim::hmc_set_link_config(unsigned src_hmcId, unsigned src_linkId,
   // adjust routing as of multiple HMCs
   this->cubes[src_hmcId]->get_partial_link_graph(dst_hmcId)->links |= (0x1 << src_linkId);
   this->cubes[dst_hmcId]->get_partial_link_graph(src_hmcId)->links |= (0x1 << dst_linkId);
-  this->cubes[src_hmcId]->hmc_routing_tables_update(); // just one needed ...
-  this->cubes[src_hmcId]->hmc_routing_tables_visualize();
+  this->routing_dirty = true;
+
+#ifdef HMC_USES_THREADS
+  linkend0->__get_rx_q()->set_staged();
+  linkend1->__get_rx_q()->set_staged();
+  this->staged_queues.push_back(linkend0->__get_rx_q());
+  this->staged_queues.push_back(linkend1->__get_rx_q());
+#endif /* #ifdef HMC_USES_THREADS */
 
   this->link_garbage.push_back(linkend0);
   this->link_garbage.push_back(linkend1);
+  this->ext_links.push_back({ src_hmcId, src_linkId, dst_hmcId, dst_linkId, linkend0, linkend1 });
   return true;
 }
 
+void hmc_sim::hmc_set_multipath(enum hmc_multipath multipath)
+{
+  for (unsigned i = 0; i < this->cubes.size(); i++)
+    this->cubes[i]->set_multipath(multipath);
+}
+
+#ifdef HMC_USES_COUNTERS
+void hmc_sim::hmc_link_report(std::ostream &os)
+{
+  for (auto it = this->ext_links.begin(); it != this->ext_links.end(); ++it) {
+    for (unsigned dir = 0; dir < 2; dir++) {
+      // a direction is counted by the receiving end
+      const hmc_counter_block *ctrs = (!dir ? it->dst : it->src)->__get_rx_q()->get_counters();
+      uint64_t busy = ctrs->get(HMC_CTR_QUEUE_BUSY);
+      os << "link cube" << (!dir ? it->src_hmcId : it->dst_hmcId) << ".quad" << (!dir ? it->src_linkId : it->dst_linkId)
+         << " -> cube" << (!dir ? it->dst_hmcId : it->src_hmcId) << ".quad" << (!dir ? it->dst_linkId : it->src_linkId)
+         << ": packets " << ctrs->get(HMC_CTR_QUEUE_PACKETS) << ", flits " << ctrs->get(HMC_CTR_QUEUE_FLITS)
+         << ", utilisation " << (this->clk ? (100.0 * busy) / this->clk : 0.0) << "%" << std::endl;
+    }
+  }
+}
+#endif /* #ifdef HMC_USES_COUNTERS */
+
 hmc_notify* hmc_sim::hmc_define_slid(unsigned slidId, unsigned hmcId, unsigned linkId,
                                      unsigned lanes, float bitrate)
 {
@@ -152,7 +266,7 @@ hmc_notify* hmc_sim::hmc_define_slid(unsigned slidId, unsigned hmcId, unsigned l
     std::cerr << "Defined hmc heigher than amount of hmcs defined (" << hmcId << " / " << this->cubes.size() << ")" << std::endl;
     return nullptr;
   }
-  if (this->slids.find(slidId) != this->slids.end()) {
+  if (this->slids[slidId] != nullptr) {
     std::cerr << "ERROR: slid already set!" << std::endl;
     return nullptr;
   }
@@ -166,6 +280,11 @@ hmc_notify* hmc_sim::hmc_define_slid(unsigned slidId, unsigned hmcId, unsigned l
   linkend0->connect_linkports(linkend1);
   linkend0->adjust_both_linkends(lanes, bitrate, FLIT_WIDTH * RETRY_BUFFER_FLITS);
   linkend1->set_ilink_notify(slidId, slidId, &this->slidnotify, &this->slidbufnotify); // important 1!! -> will be return for slid
+#ifdef HMC_USES_THREADS
+  // pushed by the cube, clocked by the simulator
+  linkend1->__get_rx_q()->set_staged();
+  this->staged_queues.push_back(linkend1->__get_rx_q());
+#endif /* #ifdef HMC_USES_THREADS */
 
   this->link_garbage.push_back(linkend0);
   this->link_garbage.push_back(linkend1);
@@ -186,16 +305,68 @@ hmc_notify* hmc_sim::hmc_get_slid_notify(void)
 }
 #endif /* #ifdef HMC_USES_GRAPHVIZ */
 
-bool hmc_sim::hmc_send_pkt(unsigned slidId, char *pkt)
+hmc_link* hmc_sim::hmc_get_slid(unsigned slidId)
 {
   if (slidId >= this->num_slids) {
     std::cerr << "ERROR: defined slid heigher than amount of slids defined (" << slidId << " / " << this->num_slids << ")" << std::endl;
-    return false;
+    return nullptr;
   }
-  if (this->slids.find(slidId) == this->slids.end()) {
+  hmc_link *slidlink = this->slids[slidId];
+  if (slidlink == nullptr) {
     std::cerr << "ERROR: slid not set! Most likely initialisation error!" << std::endl;
-    return false;
+    return nullptr;
   }
+  return slidlink;
+}
+
+// the topology is complete, as soon as the first packet is sent
+void hmc_sim::hmc_routing_finalize(void)
+{
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  this->cubes[0]->hmc_routing_tables_update(); // just one needed ...
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+  this->cubes[0]->hmc_routing_tables_visualize();
+  std::cout << "HMC_ROUTE: routing tables of " << this->cubes.size() << " cubes computed in " << ms << " ms" << std::endl;
+  this->routing_dirty = false;
+}
+
+// hands a pooled packet over to the slid, the caller keeps it if false is returned
+bool hmc_sim::hmc_push_pkt(hmc_link *slidlink, unsigned slidId, char *packet, unsigned flits)
+{
+  if (__builtin_expect(this->routing_dirty, 0))
+    this->hmc_routing_finalize();
+
+  packet[0] |= HMCSIM_PACKET_SET_REQUEST(); // still a hack
+
+  uint64_t *tail = &((uint64_t*)packet)[HMC_PACKET_TAIL_IDX(flits)];
+  *tail &= ~(uint64_t)HMCSIM_PACKET_REQUEST_SET_SLID(~0x0); // mask out whatever is set for slid
+  *tail |= (uint64_t)HMCSIM_PACKET_REQUEST_SET_SLID(slidId); // set slidId
+
+  uint64_t header = HMC_PACKET_HEADER(packet);
+  uint64_t addr = HMCSIM_PACKET_REQUEST_GET_ADRS(header);
+  struct hmc_packet_meta *meta = hmc_pool::meta(packet);
+  unsigned cub = HMCSIM_PACKET_REQUEST_GET_CUB(header);
+  hmc_cube *cube = this->cubes[cub];
+  meta->injected = this->clk;
+  meta->hops = 0;
+  meta->cub = cub;
+  meta->quad = cube->HMCSIM_UTIL_DECODE_QUAD(addr);
+  meta->vault = cube->HMCSIM_UTIL_DECODE_VAULT(addr);
+  meta->bank = cube->HMCSIM_UTIL_DECODE_BANK(addr);
+  meta->slid = slidId;
+  meta->exit_cub = (uint8_t)~0x0;
+
+  if (!slidlink->get_tx()->push_back(packet, flits * FLIT_WIDTH))
+    return false;
+#ifdef HMC_USES_LATENCY
+  this->latency_sent(slidId, packet);
+#endif /* #ifdef HMC_USES_LATENCY */
+  return true;
+}
+
+// copies the host's packet into the pool and hands it over to the slid
+bool hmc_sim::hmc_copy_pkt_in(hmc_link *slidlink, unsigned slidId, char *pkt)
+{
   if (pkt == nullptr) {
     std::cerr << "ERROR: packet is nullptr!" << std::endl;
     return false;
@@ -207,43 +378,139 @@ bool hmc_sim::hmc_send_pkt(unsigned slidId, char *pkt)
 
   unsigned flits = HMCSIM_PACKET_REQUEST_GET_LNG(header);
   unsigned flitwidthInBit = flits * FLIT_WIDTH;
-  hmc_link_queue *slid = this->slids[slidId]->get_tx();
-  if (!slid->has_space(flitwidthInBit)) // check if we have space!
+  if (!slidlink->get_tx()->has_space(flitwidthInBit)) // check if we have space!
     return false;
 
-  char *packet = new char[flitwidthInBit / (sizeof(char) * 8)];
+#ifdef HMC_USES_TIMING_ONLY
+  char *packet = this->pool.alloc(HMC_PACKET_STORED_FLITS(flits));
+  ((uint64_t*)packet)[0] = header;
+  ((uint64_t*)packet)[1] = ((uint64_t*)pkt)[(flits << 1) - 1];
+#else
+  char *packet = this->pool.alloc(flits);
   memcpy(packet, pkt, flitwidthInBit / (sizeof(char) * 8));
-  packet[0] |= HMCSIM_PACKET_SET_REQUEST(); // still a hack
+#endif /* #ifdef HMC_USES_TIMING_ONLY */
+
+  if (!this->hmc_push_pkt(slidlink, slidId, packet, flits)) {
+    this->pool.release(packet);
+    return false;
+  }
+  return true;
+}
 
-  unsigned len64bit = flits << 1;
-  ((uint64_t*)packet)[len64bit - 1] &= ~(uint64_t)HMCSIM_PACKET_REQUEST_SET_SLID(~0x0); // mask out whatever is set for slid
-  ((uint64_t*)packet)[len64bit - 1] |= (uint64_t)HMCSIM_PACKET_REQUEST_SET_SLID(slidId); // set slidId
+// pops the next response of the slid, copies it out to pkt (if given) and releases it
+bool hmc_sim::hmc_copy_pkt_out(hmc_link *slidlink, unsigned slidId, char *pkt)
+{
+  hmc_link_fifo *rx = slidlink->get_rx_fifo_out();
+  if (rx->empty())
+    return false;
 
-  return slid->push_back(packet, flits * FLIT_WIDTH);
+  unsigned recvpacketleninbit;
+  char *packet = rx->front(&recvpacketleninbit);
+  rx->pop_front();
+#ifdef HMC_USES_LATENCY
+  this->latency_received(slidId, packet);
+#endif /* #ifdef HMC_USES_LATENCY */
+  if (pkt != nullptr) {
+#ifdef HMC_USES_TIMING_ONLY
+    // the payload is left as it is, header and tail go to their regular place
+    unsigned len64bit = recvpacketleninbit / 64;
+    ((uint64_t*)pkt)[0] = ((uint64_t*)packet)[0];
+    ((uint64_t*)pkt)[len64bit - 1] = ((uint64_t*)packet)[1];
+#else
+    memcpy(pkt, packet, recvpacketleninbit / 8);
+#endif /* #ifdef HMC_USES_TIMING_ONLY */
+  }
+  this->pool.release(packet);
+  return true;
 }
 
-bool hmc_sim::hmc_recv_pkt(unsigned slidId, char *pkt)
+bool hmc_sim::hmc_send_pkt(unsigned slidId, char *pkt)
 {
-  if (slidId >= this->num_slids) {
-    std::cerr << "ERROR: defined slid heigher than amount of slids defined (" << slidId << " / " << this->num_slids << ")" << std::endl;
+  hmc_link *slidlink = this->hmc_get_slid(slidId);
+  if (slidlink == nullptr)
     return false;
+
+  return this->hmc_copy_pkt_in(slidlink, slidId, pkt);
+}
+
+unsigned hmc_sim::hmc_send_pkts(unsigned slidId, char **pkts, unsigned n)
+{
+  hmc_link *slidlink = this->hmc_get_slid(slidId);
+  if (slidlink == nullptr)
+    return 0;
+
+  unsigned i;
+  for (i = 0; i < n; i++) {
+    if (!this->hmc_copy_pkt_in(slidlink, slidId, pkts[i]))
+      break;
   }
-  if (this->slids.find(slidId) == this->slids.end()) {
-    std::cerr << "ERROR: slid not set! Most likely initialisation error!" << std::endl;
+  return i;
+}
+
+bool hmc_sim::hmc_send_pkt_owned(unsigned slidId, char *pkt)
+{
+  hmc_link *slidlink = this->hmc_get_slid(slidId);
+  if (slidlink == nullptr)
+    return false;
+  if (pkt == nullptr) {
+    std::cerr << "ERROR: packet is nullptr!" << std::endl;
     return false;
   }
 
-  unsigned recvpacketleninbit;
-  hmc_link_fifo *rx = this->slids[slidId]->get_rx_fifo_out();
-  char *packet = rx->front(&recvpacketleninbit);
-  if (packet == nullptr)
+  uint64_t header = HMC_PACKET_HEADER(pkt);
+
+  assert(HMCSIM_PACKET_REQUEST_GET_CUB(header) < this->cubes.size());
+
+  unsigned flits = HMCSIM_PACKET_REQUEST_GET_LNG(header);
+  if (!slidlink->get_tx()->has_space(flits * FLIT_WIDTH)) // check if we have space!
+    return false;
+
+#ifdef HMC_USES_TIMING_ONLY
+  ((uint64_t*)pkt)[1] = ((uint64_t*)pkt)[(flits << 1) - 1]; // the host's tail is kept for a retry
+#endif /* #ifdef HMC_USES_TIMING_ONLY */
+  return this->hmc_push_pkt(slidlink, slidId, pkt, flits);
+}
+
+bool hmc_sim::hmc_recv_pkt(unsigned slidId, char *pkt)
+{
+  hmc_link *slidlink = this->hmc_get_slid(slidId);
+  if (slidlink == nullptr)
     return false;
 
+  return this->hmc_copy_pkt_out(slidlink, slidId, pkt);
+}
+
+unsigned hmc_sim::hmc_recv_pkts(unsigned slidId, char **pkts, unsigned max)
+{
+  hmc_link *slidlink = this->hmc_get_slid(slidId);
+  if (slidlink == nullptr)
+    return 0;
+
+  unsigned i;
+  for (i = 0; i < max; i++) {
+    if (!this->hmc_copy_pkt_out(slidlink, slidId, (pkts != nullptr) ? pkts[i] : nullptr))
+      break;
+  }
+  return i;
+}
+
+char* hmc_sim::hmc_recv_pkt_view(unsigned slidId)
+{
+  hmc_link *slidlink = this->hmc_get_slid(slidId);
+  if (slidlink == nullptr)
+    return nullptr;
+
+  hmc_link_fifo *rx = slidlink->get_rx_fifo_out();
+  if (rx->empty())
+    return nullptr;
+
+  unsigned recvpacketleninbit;
+  char *packet = rx->front(&recvpacketleninbit);
   rx->pop_front();
-  if (pkt != nullptr)
-    memcpy(pkt, packet, recvpacketleninbit / 8);
-  delete[] packet;
-  return true;
+#ifdef HMC_USES_LATENCY
+  this->latency_received(slidId, packet);
+#endif /* #ifdef HMC_USES_LATENCY */
+  return packet;
 }
 
 void hmc_sim::hmc_decode_pkt(char *packet, uint64_t *response_head, uint64_t *response_tail,
@@ -254,7 +521,7 @@ void hmc_sim::hmc_decode_pkt(char *packet, uint64_t *response_head, uint64_t *re
   uint64_t header = HMC_PACKET_HEADER(packet);
 
   uint8_t flits = (uint8_t)HMCSIM_PACKET_RESPONSE_GET_LNG(header);
-  uint64_t tail = ((uint64_t*)packet)[ (flits << 1) - 1 ];
+  uint64_t tail = HMC_PACKET_RESP_TAIL(packet);
 
   if (response_head != NULL)
     *response_head = header;
@@ -289,87 +556,8 @@ void hmc_sim::hmc_decode_pkt(char *packet, uint64_t *response_head, uint64_t *re
 void hmc_sim::hmc_encode_pkt(unsigned cub, unsigned quad, unsigned vault, unsigned bank, unsigned dram,
                              uint16_t tag, hmc_rqst_t cmd, char *packet)
 {
-  unsigned flits = 0;
-  switch (cmd) { // ToDo: would be nice, if their would be something common -> see hmc_process_packet.h
-  case RD16:
-  case RD32:
-  case RD48:
-  case RD64:
-  case RD80:
-  case RD96:
-  case RD112:
-  case RD128:
-  case RD256:
-  case MD_RD:
-  case FLOW_NULL:   // right?
-  case PRET:
-  case TRET:
-  case IRTRY:
-  case INC8:
-  case P_INC8:
-    flits = 1;
-    break;
-  case WR16:
-  case MD_WR:
-  case BWR:
-  case TWOADD8:
-  case ADD16:
-  case TWOADDS8R:
-  case ADDS16R:
-  case XOR16:
-  case OR16:
-  case NOR16:
-  case AND16:
-  case NAND16:
-  case CASGT8:
-  case CASGT16:
-  case CASLT8:
-  case CASLT16:
-  case CASEQ8:
-  case CASZERO16:
-  case EQ8:
-  case EQ16:
-  case BWR8R:
-  case SWAP16:
-  case P_WR16:
-  case P_BWR:
-  case P_2ADD8:
-  case P_ADD16:
-    flits = 2;
-    break;
-  case WR32:
-  case P_WR32:
-    flits = 3;
-    break;
-  case WR48:
-  case P_WR48:
-    flits = 4;
-    break;
-  case WR64:
-  case P_WR64:
-    flits = 5;
-    break;
-  case WR80:
-  case P_WR80:
-    flits = 6;
-    break;
-  case WR96:
-  case P_WR96:
-    flits = 7;
-    break;
-  case WR112:
-  case P_WR112:
-    flits = 8;
-    break;
-  case WR128:
-  case P_WR128:
-    flits = 9;
-    break;
-  case WR256:
-  case P_WR256:
-    flits = 17;
-    break;
-  default:
+  unsigned flits = hmc_cmd_get(cmd)->rqst_flits;
+  if (cmd >= HMC_CMD_TABLE_SIZE || !flits) {
     // ToDo: CMC!
     throw false;
   }
@@ -404,87 +592,8 @@ void hmc_sim::hmc_encode_pkt(unsigned cub, unsigned quad, unsigned vault, unsign
 void hmc_sim::hmc_encode_pkt(unsigned cub, uint64_t addr,
                              uint16_t tag, hmc_rqst_t cmd, char *packet)
 {
-  unsigned flits = 0;
-  switch (cmd) { // ToDo: would be nice, if their would be something common -> see hmc_process_packet.h
-  case RD16:
-  case RD32:
-  case RD48:
-  case RD64:
-  case RD80:
-  case RD96:
-  case RD112:
-  case RD128:
-  case RD256:
-  case MD_RD:
-  case FLOW_NULL:   // right?
-  case PRET:
-  case TRET:
-  case IRTRY:
-  case INC8:
-  case P_INC8:
-    flits = 1;
-    break;
-  case WR16:
-  case MD_WR:
-  case BWR:
-  case TWOADD8:
-  case ADD16:
-  case TWOADDS8R:
-  case ADDS16R:
-  case XOR16:
-  case OR16:
-  case NOR16:
-  case AND16:
-  case NAND16:
-  case CASGT8:
-  case CASGT16:
-  case CASLT8:
-  case CASLT16:
-  case CASEQ8:
-  case CASZERO16:
-  case EQ8:
-  case EQ16:
-  case BWR8R:
-  case SWAP16:
-  case P_WR16:
-  case P_BWR:
-  case P_2ADD8:
-  case P_ADD16:
-    flits = 2;
-    break;
-  case WR32:
-  case P_WR32:
-    flits = 3;
-    break;
-  case WR48:
-  case P_WR48:
-    flits = 4;
-    break;
-  case WR64:
-  case P_WR64:
-    flits = 5;
-    break;
-  case WR80:
-  case P_WR80:
-    flits = 6;
-    break;
-  case WR96:
-  case P_WR96:
-    flits = 7;
-    break;
-  case WR112:
-  case P_WR112:
-    flits = 8;
-    break;
-  case WR128:
-  case P_WR128:
-    flits = 9;
-    break;
-  case WR256:
-  case P_WR256:
-    flits = 17;
-    break;
-  default:
+  unsigned flits = hmc_cmd_get(cmd)->rqst_flits;
+  if (cmd >= HMC_CMD_TABLE_SIZE || !flits) {
     // ToDo: CMC!
     throw false;
   }
@@ -510,25 +619,40 @@ void hmc_sim::hmc_encode_pkt(unsigned cub, uint64_t addr,
 void hmc_sim::clock(void)
 {
   this->clk++;
+#ifdef HMC_USES_THREADS
+  for (auto it = this->staged_queues.begin(); it != this->staged_queues.end(); ++it)
+    (*it)->stage_begin();
+  this->threads->run(this->cube_tasks.size(), this->cube_task);
+
+  this->vault_tasks.clear();
+  for (auto it = this->cube_tasks.begin(); it != this->cube_tasks.end(); ++it)
+    (*it)->stage_vaults(&this->vault_tasks);
+  if (!this->vault_tasks.empty())
+    this->threads->run(this->vault_tasks.size(), this->vault_task);
+  for (auto it = this->cube_tasks.begin(); it != this->cube_tasks.end(); ++it)
+    (*it)->commit_vaults();
+
+  // in the order of creation -> deterministic
+  for (auto it = this->staged_queues.begin(); it != this->staged_queues.end(); ++it)
+    (*it)->commit();
+# ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap;
+# endif /* #ifdef HMC_USES_NOTIFY */
+#else
 #ifdef HMC_USES_NOTIFY
-  unsigned notifymap = this->cubes_notify.get_notification();
-  for (unsigned i, lid = i = __builtin_ctzl(notifymap);
-       notifymap >>= lid;
-       lid = __builtin_ctzl(notifymap >>= 1),
-       i += (lid + 1))
+  hmc_notify_map notifymap = this->cubes_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
 #else
   for (unsigned i = 0; i < this->cubes.size(); i++)
 #endif /* #ifdef HMC_USES_NOTIFY */
   {
     this->cubes[i]->clock();
   }
+#endif /* #ifdef HMC_USES_THREADS */
 
 #ifdef HMC_USES_NOTIFY
   notifymap = this->slidnotify.get_notification();
-  for (unsigned i, lid = i = __builtin_ctzl(notifymap);
-       notifymap >>= lid;
-       lid = __builtin_ctzl(notifymap >>= 1),
-       i += (lid + 1))
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
 #else
   for (unsigned i = 0; i < this->num_slids; i++)
 #endif /* #ifdef HMC_USES_NOTIFY */
@@ -540,4 +664,204 @@ void hmc_sim::clock(void)
       this->slids[i]->clock();
     }
   }
+
+#ifdef HMC_USES_COUNTERS
+  if (this->clk >= this->counters_next) {
+    this->dump_counters();
+    // clock_skip() might have jumped over a multiple of the interval
+    this->counters_next = (this->clk / this->counters_interval + 1) * this->counters_interval;
+  }
+#endif /* #ifdef HMC_USES_COUNTERS */
+}
+
+uint64_t hmc_sim::next_event(void)
+{
+  uint64_t next = HMC_NO_EVENT;
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->cubes_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < this->cubes.size(); i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    uint64_t ev = this->cubes[i]->next_event();
+    if (ev < next)
+      next = ev;
+    if (next == 1)
+      return next;
+  }
+
+#ifdef HMC_USES_NOTIFY
+  notifymap = this->slidnotify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < this->num_slids; i++)
+    if (this->slids[i] != nullptr)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    uint64_t ev = this->slids[i]->next_event();
+    if (ev < next)
+      next = ev;
+    if (next == 1)
+      return next;
+  }
+  return next;
+}
+
+void hmc_sim::fast_forward(uint64_t cycles)
+{
+  this->clk += cycles;
+#ifdef HMC_USES_NOTIFY
+  hmc_notify_map notifymap = this->cubes_notify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < this->cubes.size(); i++)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->cubes[i]->fast_forward(cycles);
+  }
+
+#ifdef HMC_USES_NOTIFY
+  notifymap = this->slidnotify.get_notification();
+  for (unsigned i = notifymap.first(); i != HMC_NOTIFY_NONE; i = notifymap.next(i + 1))
+#else
+  for (unsigned i = 0; i < this->num_slids; i++)
+    if (this->slids[i] != nullptr)
+#endif /* #ifdef HMC_USES_NOTIFY */
+  {
+    this->slids[i]->fast_forward(cycles);
+  }
+}
+
+/*
+ * Advances up to max_cycles, but jumps over all cycles in which the links are
+ * just serializing packets. It returns after the first cycle, which leaves
+ * something for the host: a packet to receive or a slid, which was full before,
+ * accepts packets again. The outcome is identical to calling clock() for every
+ * cycle, as long as the host calls it only if it can't proceed on its own
+ * (nothing to send or its slid is full). Returns the cycles advanced.
+ */
+uint64_t hmc_sim::clock_skip(uint64_t max_cycles)
+{
+  uint64_t start = this->clk;
+  unsigned full = 0x0;
+  for (unsigned i = 0; i < this->num_slids; i++) {
+    if (this->slids[i] != nullptr && !this->slids[i]->get_tx()->has_space(0))
+      full |= (0x1 << i);
+  }
+
+  while (this->clk - start < max_cycles) {
+#ifdef HMC_USES_THREADS
+    this->sync_cubes_notify();
+#endif /* #ifdef HMC_USES_THREADS */
+    uint64_t next = this->next_event();
+    for (unsigned i = 0; i < this->num_slids; i++) {
+      if (full & (0x1 << i)) {
+        uint64_t ev = this->slids[i]->get_tx()->space_event();
+        if (ev < next)
+          next = ev;
+      }
+    }
+    if (next > max_cycles - (this->clk - start))
+      next = max_cycles - (this->clk - start);
+    if (next > 1)
+      this->fast_forward(next - 1);
+    this->clock();
+
+    for (unsigned i = 0; i < this->num_slids; i++) {
+      if (this->slids[i] == nullptr)
+        continue;
+      if (!this->slids[i]->get_rx_fifo_out()->empty()
+          || ((full & (0x1 << i)) && this->slids[i]->get_tx()->has_space(0)))
+        return this->clk - start;
+    }
+  }
+  return this->clk - start;
+}
+
+#ifdef HMC_USES_THREADS
+// cubes_notify is only used by the event skipping, the cubes don't update it by themselves
+void hmc_sim::sync_cubes_notify(void)
+{
+  for (unsigned i = 0; i < this->cube_tasks.size(); i++) {
+    if (this->cube_tasks[i]->get_notification())
+      this->cubes_notify.notify_add(i);
+    else
+      this->cubes_notify.notify_del(i);
+  }
+}
+#endif /* #ifdef HMC_USES_THREADS */
+
+#ifdef HMC_USES_COUNTERS
+hmc_counters* hmc_sim::hmc_get_counters(void)
+{
+  // links are defined till the first clock(), rebuild the view each time
+  this->counters.clear();
+  for (auto it = this->cubes.begin(); it != this->cubes.end(); ++it)
+    it->second->collect_counters(&this->counters, "cube" + std::to_string(it->first));
+  for (unsigned i = 0; i < HMC_MAX_SLIDS; i++) {
+    if (this->slids[i] != nullptr)
+      this->slids[i]->collect_counters(&this->counters, "slid" + std::to_string(i));
+  }
+  return &this->counters;
+}
+
+bool hmc_sim::hmc_get_counter(const char *name, uint64_t *value)
+{
+  return this->hmc_get_counters()->get(name, value);
+}
+
+bool hmc_sim::hmc_dump_counters(const char *file, uint64_t interval, bool json)
+{
+  if (this->counters_file.is_open())
+    this->counters_file.close();
+  this->counters_file.open(file, std::ofstream::out | std::ofstream::trunc);
+  if (!this->counters_file.is_open()) {
+    std::cerr << "ERROR: couldn't open counters file '" << file << "'!" << std::endl;
+    return false;
+  }
+  this->counters_json = json;
+  this->counters_interval = interval;
+  this->counters_next = interval ? (this->clk / interval + 1) * interval : ~0ULL;
+  if (!json)
+    this->counters_file << "cycle,name,value\n";
+  return true;
+}
+
+void hmc_sim::dump_counters(void)
+{
+  hmc_counters *ctrs = this->hmc_get_counters();
+  if (this->counters_json)
+    ctrs->dump_json(this->counters_file, this->clk);
+  else
+    ctrs->dump_csv(this->counters_file, this->clk, false);
+}
+#endif /* #ifdef HMC_USES_COUNTERS */
+
+#ifdef HMC_USES_LATENCY
+void hmc_sim::latency_sent(unsigned slidId, char *packet)
+{
+  uint64_t header = HMC_PACKET_HEADER(packet);
+  unsigned cmd = HMCSIM_PACKET_REQUEST_GET_CMD(header);
+  if (!hmc_cmd_get(cmd)->rsp)
+    return; // posted
+
+  const struct hmc_packet_meta *meta = hmc_pool::meta(packet);
+  unsigned vault = meta->quad * (HMC_NUM_VAULTS / HMC_NUM_QUADS) + meta->vault;
+  this->latency->sent(slidId, HMCSIM_PACKET_REQUEST_GET_TAG(header), meta->injected, meta->cub, vault, cmd);
+}
+
+void hmc_sim::latency_received(unsigned slidId, char *packet)
+{
+  this->latency->received(slidId, HMCSIM_PACKET_RESPONSE_GET_TAG(HMC_PACKET_HEADER(packet)), this->clk);
+}
+
+bool hmc_sim::hmc_get_latency(enum hmc_latency_group group, unsigned id, double percentile, uint64_t *cycles)
+{
+  const hmc_histogram *h = this->latency->get(group, id);
+  if (h == nullptr || !h->get_count())
+    return false;
+  *cycles = h->percentile(percentile);
+  return true;
 }
+#endif /* #ifdef HMC_USES_LATENCY */
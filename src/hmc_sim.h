@@ -1,9 +1,14 @@
 #ifndef _HMC_SIM_H_
 #define _HMC_SIM_H_
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <list>
+#include <vector>
+#ifdef HMC_USES_THREADS
+# include <functional>
+#endif /* #ifdef HMC_USES_THREADS */
 #if defined(NDEBUG) && defined(HMC_USES_CRC)
 #include <zlib.h> // crc32(), uLong
 #endif /* #if defined(NDEBUG) && defined(HMC_USES_CRC) */
@@ -12,6 +17,25 @@
 #include "hmc_jtag.h"
 #include "hmc_macros.h"
 #include "hmc_notify.h"
+#include "hmc_pool.h"
+#include "hmc_route.h" // enum hmc_multipath
+#ifdef HMC_USES_LATENCY
+# include "hmc_latency.h"
+#endif /* #ifdef HMC_USES_LATENCY */
+#ifdef HMC_USES_COUNTERS
+# include <fstream>
+# include "hmc_counters.h"
+#endif /* #ifdef HMC_USES_COUNTERS */
+#ifdef HMC_USES_THREADS
+# include "hmc_quad.h"
+# include "hmc_thread_pool.h"
+# if defined(HMC_LOGGING) && !defined(HMC_LOGGING_BINARY)
+#  error "HMC_USES_THREADS: only the binary trace backend is thread safe, use HMC_LOGGING_BINARY or turn off HMC_LOGGING"
+# endif /* #if defined(HMC_LOGGING) && !defined(HMC_LOGGING_BINARY) */
+#endif /* #ifdef HMC_USES_THREADS */
+
+static_assert(HMC_MAX_DEVS <= HMC_NOTIFY_MAX_CHILDREN, "HMC_MAX_DEVS exceeds HMC_NOTIFY_MAX_CHILDREN");
+static_assert(HMC_MAX_SLIDS <= HMC_NOTIFY_MAX_CHILDREN, "HMC_MAX_SLIDS exceeds HMC_NOTIFY_MAX_CHILDREN");
 
 /* link bit rate in Gb/s */
 #define HMCSIM_BR12_5   12.5f
@@ -36,28 +60,93 @@ enum link_width_t {
 };
 
 class hmc_link;
+class hmc_link_queue;
 class hmc_cube;
 class hmc_slid;
 
 class hmc_sim : private hmc_notify_cl {
 private:
   uint64_t clk;
+  hmc_pool pool;
   hmc_notify cubes_notify;
   std::map<unsigned, hmc_cube*> cubes;
   hmc_jtag* jtags[HMC_MAX_DEVS];
 
-  std::map<unsigned, hmc_link*> slids;
+  // indexed by slid, nullptr if not defined
+  std::array<hmc_link*, HMC_MAX_SLIDS> slids;
 
   hmc_notify slidnotify;
   hmc_notify slidbufnotify;
   unsigned num_slids;
   unsigned num_links;
+  // links were added, the routing tables are computed with the next packet sent
+  bool routing_dirty;
 
   std::list<hmc_link*> link_garbage;
+  // links between cubes, as set up by hmc_set_link_config()
+  struct hmc_ext_link {
+    unsigned src_hmcId;
+    unsigned src_linkId;
+    unsigned dst_hmcId;
+    unsigned dst_linkId;
+    hmc_link *src;
+    hmc_link *dst;
+  };
+  std::vector<struct hmc_ext_link> ext_links;
   std::list<hmc_slid*> slidModule_garbage;
 
+#ifdef HMC_USES_THREADS
+  /*
+   * A cycle runs in two phases: first the connection of each cube is clocked by
+   * a task of its own, afterwards every active vault of all cubes. Cubes only
+   * meet at EXTERN links (and the slids), pushes onto those are staged and
+   * committed after all cubes are done. They decide on the link occupation at
+   * the begin of the cycle, therewith the outcome does not depend on the amount
+   * of threads. Vault responses are staged the same way (see hmc_quad).
+   */
+  hmc_thread_pool *threads;
+  std::vector<hmc_cube*> cube_tasks;
+  std::function<void(unsigned)> cube_task;
+  std::vector<hmc_vault_task> vault_tasks;
+  std::function<void(unsigned)> vault_task;
+  std::vector<hmc_link_queue*> staged_queues;
+
+  void sync_cubes_notify(void);
+#endif /* #ifdef HMC_USES_THREADS */
+
+#ifdef HMC_USES_COUNTERS
+  /*
+   * Periodic snapshots of all counters, every counters_interval cycles (0: only
+   * at the end). Set up by hmc_dump_counters(), or by the env variables
+   * HMCSIM_COUNTERS_FILE (*.json for JSON Lines, CSV otherwise) and
+   * HMCSIM_COUNTERS_INTERVAL.
+   */
+  hmc_counters counters;
+  std::ofstream counters_file;
+  bool counters_json;
+  uint64_t counters_interval;
+  uint64_t counters_next;
+
+  void dump_counters(void);
+#endif /* #ifdef HMC_USES_COUNTERS */
+#ifdef HMC_USES_LATENCY
+  hmc_latency *latency;
+
+  void latency_sent(unsigned slidId, char *packet);
+  void latency_received(unsigned slidId, char *packet);
+#endif /* #ifdef HMC_USES_LATENCY */
+
   bool notify_up(unsigned id);
 
+  hmc_link* hmc_get_slid(unsigned slidId);
+  bool hmc_push_pkt(hmc_link *slidlink, unsigned slidId, char *packet, unsigned flits);
+  void hmc_routing_finalize(void);
+  bool hmc_copy_pkt_in(hmc_link *slidlink, unsigned slidId, char *pkt);
+  bool hmc_copy_pkt_out(hmc_link *slidlink, unsigned slidId, char *pkt);
+
+  uint64_t next_event(void);
+  void fast_forward(uint64_t cycles);
+
   unsigned seq = 0x0;
   ALWAYS_INLINE uint8_t hmcsim_rqst_getseq(hmc_rqst_t cmd) // ToDo!
   {
@@ -119,6 +208,38 @@ public:
 
   bool hmc_send_pkt(unsigned slidId, char *pkt);
   bool hmc_recv_pkt(unsigned slidId, char *pkt);
+  // bursts: send in order till the slid stalls / receive all ready responses, return the amount done
+  unsigned hmc_send_pkts(unsigned slidId, char **pkts, unsigned n);
+  unsigned hmc_recv_pkts(unsigned slidId, char **pkts, unsigned max);
+
+  /*
+   * Zero-copy variants: the host builds its requests directly within a packet
+   * of the simulator's pool (hmc_alloc_pkt). hmc_send_pkt_owned() takes it over
+   * on success, otherwise it stays with the host. hmc_recv_pkt_view() hands out
+   * the response itself, it has to be given back by hmc_release_pkt().
+   * With HMC_USES_TIMING_ONLY the response holds header and tail only (see
+   * HMC_PACKET_RESP_TAIL()).
+   */
+  ALWAYS_INLINE char* hmc_alloc_pkt(unsigned flits)
+  {
+    return this->pool.alloc(flits);
+  }
+  ALWAYS_INLINE void hmc_release_pkt(char *pkt)
+  {
+    this->pool.release(pkt);
+  }
+  // routing fields, injection cycle and hops of a packet handed out by hmc_recv_pkt_view()
+  ALWAYS_INLINE const struct hmc_packet_meta* hmc_get_pkt_meta(char *pkt)
+  {
+    return hmc_pool::meta(pkt);
+  }
+  bool hmc_send_pkt_owned(unsigned slidId, char *pkt);
+  char* hmc_recv_pkt_view(unsigned slidId);
+
+  ALWAYS_INLINE void hmc_get_pool_stats(unsigned flits, struct hmc_pool_stats *stats)
+  {
+    this->pool.get_stats(flits, stats);
+  }
 
   void hmc_decode_pkt(char *packet, uint64_t *header, uint64_t *tail,
                       hmc_response_t *type, unsigned *flits, uint16_t *tag,
@@ -129,7 +250,37 @@ public:
   void hmc_encode_pkt(unsigned cub, uint64_t addr,
                       uint16_t tag, hmc_rqst_t cmd, char *packet);
 
+  // how packets are spread over several links towards the next cube, default: env HMCSIM_MULTIPATH
+  void hmc_set_multipath(enum hmc_multipath multipath);
+
+#ifdef HMC_USES_COUNTERS
+  // packets, FLITs and utilisation (busy cycles / cycles) of each direction of the links between cubes
+  void hmc_link_report(std::ostream &os);
+  // named "cube<id>.quad<q>.vault<v>.rqsts", "slid<id>.q.stalls", ...
+  hmc_counters* hmc_get_counters(void);
+  bool hmc_get_counter(const char *name, uint64_t *value);
+  bool hmc_dump_counters(const char *file, uint64_t interval, bool json);
+#endif /* #ifdef HMC_USES_COUNTERS */
+
+#ifdef HMC_USES_LATENCY
+  // end-to-end latency of the responses received so far, see hmc_latency.h
+  ALWAYS_INLINE const hmc_histogram* hmc_get_latency_histogram(enum hmc_latency_group group, unsigned id)
+  {
+    return this->latency->get(group, id);
+  }
+  bool hmc_get_latency(enum hmc_latency_group group, unsigned id, double percentile, uint64_t *cycles);
+  ALWAYS_INLINE void hmc_latency_report(std::ostream &os)
+  {
+    this->latency->report(os);
+  }
+  ALWAYS_INLINE void hmc_latency_reset(void)
+  {
+    this->latency->reset();
+  }
+#endif /* #ifdef HMC_USES_LATENCY */
+
   void clock(void);
+  uint64_t clock_skip(uint64_t max_cycles);
   uint64_t hmc_get_clock(void) {
     return this->clk;
   }
@@ -0,0 +1,78 @@
+#include <cassert>
+#include "hmc_thread_pool.h"
+
+hmc_thread_pool::hmc_thread_pool(unsigned threads) :
+  state(0),
+  done(0),
+  quit(false),
+  fn(nullptr)
+{
+  for (unsigned i = 1; i < threads; i++)
+    this->workers.push_back(std::thread(&hmc_thread_pool::worker, this));
+}
+
+hmc_thread_pool::~hmc_thread_pool(void)
+{
+  this->quit.store(true, std::memory_order_release);
+  for (auto it = this->workers.begin(); it != this->workers.end(); ++it)
+    it->join();
+}
+
+// a task is claimed by a CAS on state, therewith a late worker can't steal from the next generation
+void hmc_thread_pool::work(uint64_t generation)
+{
+  uint64_t s = this->state.load(std::memory_order_acquire);
+  while ((s >> 32) == generation
+         && (s & 0xFFFF) < ((s >> 16) & 0xFFFF)) {
+    if (this->state.compare_exchange_weak(s, s + 1, std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+      (*this->fn)(s & 0xFFFF);
+      this->done.fetch_add(1, std::memory_order_release);
+      s = this->state.load(std::memory_order_acquire);
+    }
+  }
+}
+
+void hmc_thread_pool::worker(void)
+{
+  uint64_t seen = 0;
+  unsigned spins = 0;
+  while (!this->quit.load(std::memory_order_acquire)) {
+    uint64_t generation = this->state.load(std::memory_order_acquire) >> 32;
+    if (generation == seen) {
+      if (++spins >= HMC_THREAD_POOL_SPINS) {
+        std::this_thread::yield();
+        spins = 0;
+      }
+      continue;
+    }
+    seen = generation;
+    spins = 0;
+    this->work(generation);
+  }
+}
+
+void hmc_thread_pool::run(unsigned tasks, const std::function<void(unsigned)> &fn)
+{
+  assert(tasks <= 0xFFFF);
+  if (this->workers.empty()) {
+    for (unsigned i = 0; i < tasks; i++)
+      fn(i);
+    return;
+  }
+
+  uint64_t generation = ((this->state.load(std::memory_order_relaxed) >> 32) + 1) & 0xFFFFFFFF;
+  this->fn = &fn;
+  this->done.store(0, std::memory_order_relaxed);
+  this->state.store((generation << 32) | ((uint64_t)tasks << 16), std::memory_order_release);
+
+  this->work(generation);
+
+  unsigned spins = 0;
+  while (this->done.load(std::memory_order_acquire) != tasks) {
+    if (++spins >= HMC_THREAD_POOL_SPINS) {
+      std::this_thread::yield();
+      spins = 0;
+    }
+  }
+}
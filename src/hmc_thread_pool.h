@@ -0,0 +1,42 @@
+#ifndef _HMC_THREAD_POOL_H_
+#define _HMC_THREAD_POOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of workers, which are kept spinning between two runs, since a run
+ * (one simulation cycle) is way too short to put them asleep. run() hands out
+ * the task ids [0, tasks) to whoever comes first, the calling thread takes part
+ * and returns after the last task is done (barrier).
+ */
+#define HMC_THREAD_POOL_SPINS   4096
+
+class hmc_thread_pool {
+private:
+  std::vector<std::thread> workers;
+  // [63:32] generation, [31:16] amount of tasks, [15:0] next task
+  std::atomic<uint64_t> state;
+  std::atomic<unsigned> done;
+  std::atomic<bool> quit;
+  const std::function<void(unsigned)> *fn;
+
+  void work(uint64_t generation);
+  void worker(void);
+
+public:
+  explicit hmc_thread_pool(unsigned threads);
+  ~hmc_thread_pool(void);
+
+  unsigned get_threads(void)
+  {
+    return this->workers.size() + 1;
+  }
+
+  void run(unsigned tasks, const std::function<void(unsigned)> &fn);
+};
+
+#endif /* #ifndef _HMC_THREAD_POOL_H_ */
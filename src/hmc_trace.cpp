@@ -1,4 +1,8 @@
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "hmc_decode.h"
 #include "hmc_trace.h"
 #if defined(HMC_LOGGING_SQLITE3)
 # include "hmc_trace_sqlite3.h"
@@ -6,23 +10,172 @@
 # include "hmc_trace_postgresql.h"
 #elif defined(HMC_LOGGING_STDOUT)
 # include "hmc_trace_stdout.h"
+#elif defined(HMC_LOGGING_BINARY)
+# include "hmc_trace_binary.h"
 # endif
 
 static hmc_trace_logger *logger = nullptr;
 
+#define HMC_TRACE_ALL_LINKS ((1 << HMC_LINK_EXTERN) | (1 << HMC_LINK_RING) | (1 << HMC_LINK_VAULT_IN) \
+                             | (1 << HMC_LINK_VAULT_OUT) | (1 << HMC_LINK_SLID))
+
+uint32_t hmc_trace::links = HMC_TRACE_ALL_LINKS;
+uint32_t hmc_trace::link_mask = HMC_TRACE_ALL_LINKS;
+uint64_t hmc_trace::cycle_start = 0;
+uint64_t hmc_trace::cycle_end = ~0ull;
+unsigned hmc_trace::level = HMC_TRACE_ALL;
+uint64_t hmc_trace::cubes = 0;
+uint64_t hmc_trace::cmds[2] = { 0, 0 };
+unsigned hmc_trace::sample = 1;
+
+void hmc_trace::set_level(enum hmc_trace_level level)
+{
+  hmc_trace::level = level;
+  hmc_trace::links = (level == HMC_TRACE_OFF) ? 0 : hmc_trace::link_mask;
+}
+
+void hmc_trace::set_link(enum hmc_link_type typeId, bool on)
+{
+  if (on)
+    hmc_trace::link_mask |= (1 << typeId);
+  else
+    hmc_trace::link_mask &= ~(1 << typeId);
+  hmc_trace::set_level((enum hmc_trace_level)hmc_trace::level);
+}
+
+void hmc_trace::set_cube(unsigned cubId, bool on)
+{
+  if (on)
+    hmc_trace::cubes |= (1ull << (cubId & 0x3F));
+  else
+    hmc_trace::cubes &= ~(1ull << (cubId & 0x3F));
+}
+
+void hmc_trace::set_cmd(unsigned cmd, bool on)
+{
+  cmd &= 0x7F;
+  if (on)
+    hmc_trace::cmds[cmd >> 6] |= (1ull << (cmd & 0x3F));
+  else
+    hmc_trace::cmds[cmd >> 6] &= ~(1ull << (cmd & 0x3F));
+}
+
+void hmc_trace::set_cycles(uint64_t start, uint64_t end)
+{
+  hmc_trace::cycle_start = start;
+  hmc_trace::cycle_end = end;
+}
+
+void hmc_trace::set_sample(unsigned n)
+{
+  hmc_trace::sample = n ? n : 1;
+}
+
+void hmc_trace::reset_filters(void)
+{
+  hmc_trace::link_mask = HMC_TRACE_ALL_LINKS;
+  hmc_trace::cubes = 0;
+  hmc_trace::cmds[0] = hmc_trace::cmds[1] = 0;
+  hmc_trace::set_cycles(0, ~0ull);
+  hmc_trace::set_sample(1);
+  hmc_trace::set_level(HMC_TRACE_ALL);
+}
+
+bool hmc_trace::filter(unsigned linkIntTypeId, int fromCubId, int toCubId, uint64_t header)
+{
+  // odd linkIntTypeIds are responses
+  if (hmc_trace::level == HMC_TRACE_RQST && (linkIntTypeId & 0x1))
+    return false;
+
+  if (hmc_trace::cubes
+      && !(fromCubId >= 0 && ((hmc_trace::cubes >> fromCubId) & 0x1))
+      && !(toCubId >= 0 && ((hmc_trace::cubes >> toCubId) & 0x1)))
+    return false;
+
+  if (hmc_trace::cmds[0] | hmc_trace::cmds[1]) {
+    // requests and responses have the CMD field at the same place
+    unsigned cmd = HMCSIM_PACKET_REQUEST_GET_CMD(header);
+    if (!((hmc_trace::cmds[cmd >> 6] >> (cmd & 0x3F)) & 0x1))
+      return false;
+  }
+
+  // the header stays the same over all hops of a packet
+  return hmc_trace::sample == 1
+         || (((header * 0x9E3779B97F4A7C15ull) >> 32) % hmc_trace::sample) == 0;
+}
+
+void hmc_trace::setup_env(void)
+{
+  const char *env;
+  if ((env = getenv("HMCSIM_TRACE_LINKS"))) {
+    static const char *names[] = { "extern", "ring", "vault_in", "vault_out", "slid" };
+    hmc_trace::link_mask = 0;
+    for (const char *s = env; *s; ) {
+      size_t len = strcspn(s, ",");
+      unsigned i;
+      for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strlen(names[i]) == len && !strncmp(s, names[i], len))
+          break;
+      }
+      if (i < sizeof(names) / sizeof(names[0]))
+        hmc_trace::link_mask |= (1 << i);
+      else
+        std::cerr << "WARNING: HMCSIM_TRACE_LINKS: unknown link type '" << std::string(s, len) << "'" << std::endl;
+      s += len + (s[len] == ',');
+    }
+  }
+  if ((env = getenv("HMCSIM_TRACE_CUBES"))) {
+    for (char *s = (char*)env; *s; ) {
+      hmc_trace::set_cube(strtoul(s, &s, 0), true);
+      s += (*s == ',');
+    }
+  }
+  if ((env = getenv("HMCSIM_TRACE_CMDS"))) {
+    for (char *s = (char*)env; *s; ) {
+      unsigned first = strtoul(s, &s, 0);
+      unsigned last = (*s == '-') ? strtoul(s + 1, &s, 0) : first;
+      for (unsigned cmd = first; cmd <= last && cmd <= 0x7F; cmd++)
+        hmc_trace::set_cmd(cmd, true);
+      s += (*s == ',');
+    }
+  }
+  if ((env = getenv("HMCSIM_TRACE_CYCLES"))) {
+    char *s;
+    uint64_t start = strtoull(env, &s, 0);
+    uint64_t end = (*s == '-' && s[1]) ? strtoull(s + 1, nullptr, 0) : ~0ull;
+    hmc_trace::set_cycles(start, end);
+  }
+  if ((env = getenv("HMCSIM_TRACE_SAMPLE")))
+    hmc_trace::set_sample(strtoul(env, nullptr, 0));
+  if ((env = getenv("HMCSIM_TRACE_LEVEL"))) {
+    if (!strcmp(env, "off") || !strcmp(env, "0"))
+      hmc_trace::level = HMC_TRACE_OFF;
+    else if (!strcmp(env, "rqst") || !strcmp(env, "1"))
+      hmc_trace::level = HMC_TRACE_RQST;
+    else if (!strcmp(env, "all") || !strcmp(env, "2"))
+      hmc_trace::level = HMC_TRACE_ALL;
+    else
+      std::cerr << "WARNING: HMCSIM_TRACE_LEVEL: unknown level '" << env << "'" << std::endl;
+  }
+  hmc_trace::set_level((enum hmc_trace_level)hmc_trace::level);
+}
+
 void hmc_trace::trace_setup(void)
 {
+  hmc_trace::setup_env();
 #if defined(HMC_LOGGING_SQLITE3)
   if (!logger) {
-    const char *dbname;
+    const char *dbname, *batch;
+    // optional: events per transaction
+    unsigned batch_size = (batch = getenv("HMCSIM_TRACE_BATCH")) ? (unsigned)strtoul(batch, nullptr, 0) : HMC_SQLITE3_BATCH;
     if (!(dbname = getenv("HMCSIM_TRACE_DBFILE"))) {
       std::cout << "WARNING: please define env variable: " \
         "HMCSIM_TRACE_DBFILE" << std::endl;
       std::cout << "         will try default param." << std::endl;
-      logger = new hmc_sqlite3();
+      logger = new hmc_sqlite3("hmcsim_sqlite3.db", true, batch_size);
     }
     else
-      logger = new hmc_sqlite3(dbname);
+      logger = new hmc_sqlite3(dbname, true, batch_size);
   }
 #elif defined(HMC_LOGGING_POSTGRESQL)
   if (!logger) {
@@ -46,6 +199,18 @@ void hmc_trace::trace_setup(void)
   }
 #elif defined(HMC_LOGGING_STDOUT)
   logger = new hmc_trace_stdout();
+#elif defined(HMC_LOGGING_BINARY)
+  if (!logger) {
+    const char *filename;
+    if (!(filename = getenv("HMCSIM_TRACE_BINFILE"))) {
+      std::cout << "WARNING: please define env variable: " \
+        "HMCSIM_TRACE_BINFILE" << std::endl;
+      std::cout << "         will try default param." << std::endl;
+      logger = new hmc_trace_binary();
+    }
+    else
+      logger = new hmc_trace_binary(filename);
+  }
 #endif
 }
 
@@ -61,7 +226,8 @@ void hmc_trace::trace_in_rqst(uint64_t cycle, uint64_t phyPktAddr,
                               int fromId, int toId,
                               uint64_t header, uint64_t tail)
 {
-  logger->execute(typeId, 0x0, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
+  if (hmc_trace::filter(0x0, fromCubId, toCubId, header))
+    logger->execute(typeId, 0x0, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
 }
 
 void hmc_trace::trace_in_rsp(uint64_t cycle, uint64_t phyPktAddr,
@@ -70,7 +236,8 @@ void hmc_trace::trace_in_rsp(uint64_t cycle, uint64_t phyPktAddr,
                              int fromId, int toId,
                              uint64_t header, uint64_t tail)
 {
-  logger->execute(typeId, 0x1, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
+  if (hmc_trace::filter(0x1, fromCubId, toCubId, header))
+    logger->execute(typeId, 0x1, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
 }
 
 void hmc_trace::trace_out_rqst(uint64_t cycle, uint64_t phyPktAddr,
@@ -79,7 +246,8 @@ void hmc_trace::trace_out_rqst(uint64_t cycle, uint64_t phyPktAddr,
                                int fromId, int toId,
                                uint64_t header, uint64_t tail)
 {
-  logger->execute(typeId, 0x2, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
+  if (hmc_trace::filter(0x2, fromCubId, toCubId, header))
+    logger->execute(typeId, 0x2, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
 }
 
 void hmc_trace::trace_out_rsp(uint64_t cycle, uint64_t phyPktAddr,
@@ -88,5 +256,6 @@ void hmc_trace::trace_out_rsp(uint64_t cycle, uint64_t phyPktAddr,
                               int fromId, int toId,
                               uint64_t header, uint64_t tail)
 {
-  logger->execute(typeId, 0x3, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
+  if (hmc_trace::filter(0x3, fromCubId, toCubId, header))
+    logger->execute(typeId, 0x3, cycle, phyPktAddr, fromCubId, toCubId, fromId, toId, header, tail);
 }
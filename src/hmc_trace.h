@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include "hmc_link.h"
+#include "hmc_macros.h"
 
 class hmc_trace_logger {
 public:
@@ -14,11 +15,60 @@ public:
                        uint64_t header, uint64_t tail) = 0;
 };
 
+enum hmc_trace_level {
+  HMC_TRACE_OFF  = 0x0,
+  HMC_TRACE_RQST = 0x1,   // requests only
+  HMC_TRACE_ALL  = 0x2
+};
+
+/*
+ * Runtime filters, all of them have to pass for an event to get logged. The
+ * link type and the cycle window are checked inline at the call site
+ * (is_active()), before any of the event's fields are gathered. Cubes,
+ * commands, and the sampling are checked once the event got built. Sampling
+ * keeps one out of N packets by a hash of the header, therewith all hops of a
+ * sampled packet are kept.
+ *
+ * Everything can be set by the API, or at trace_setup() by env variables:
+ *   HMCSIM_TRACE_LEVEL   off | rqst | all            (default: all)
+ *   HMCSIM_TRACE_LINKS   list out of extern,ring,vault_in,vault_out,slid
+ *   HMCSIM_TRACE_CUBES   list of cube ids, e.g. 0,2
+ *   HMCSIM_TRACE_CMDS    list of commands or ranges, e.g. 0x30-0x37,0x08
+ *   HMCSIM_TRACE_CYCLES  [start]-[end), e.g. 1000-2000 or 5000-
+ *   HMCSIM_TRACE_SAMPLE  N: keep 1 out of N packets
+ * Filters not set, let everything pass.
+ */
 class hmc_trace {
+private:
+  static uint32_t links;          // bit per enum hmc_link_type, 0 if off
+  static uint32_t link_mask;      // as set, kept while off
+  static uint64_t cycle_start;
+  static uint64_t cycle_end;
+  static unsigned level;
+  static uint64_t cubes;          // bit per cube id, 0: any
+  static uint64_t cmds[2];        // bit per command (7 bit), 0: any
+  static unsigned sample;
+
+  static bool filter(unsigned linkIntTypeId, int fromCubId, int toCubId, uint64_t header);
+  static void setup_env(void);
+
 public:
   static void trace_setup(void);
   static void trace_cleanup(void);
 
+  ALWAYS_INLINE static bool is_active(enum hmc_link_type typeId, uint64_t cycle)
+  {
+    return ((links >> typeId) & 0x1) && cycle >= cycle_start && cycle < cycle_end;
+  }
+
+  static void set_level(enum hmc_trace_level level);
+  static void set_link(enum hmc_link_type typeId, bool on);
+  static void set_cube(unsigned cubId, bool on);
+  static void set_cmd(unsigned cmd, bool on);
+  static void set_cycles(uint64_t start, uint64_t end);
+  static void set_sample(unsigned n);
+  static void reset_filters(void);
+
   static void trace_in_rqst(uint64_t cycle, uint64_t phyPktAddr,
                             enum hmc_link_type typeId,
                             int fromCubId, int toCubId,
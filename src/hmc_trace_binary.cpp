@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "hmc_trace_binary.h"
+
+static std::atomic<uint64_t> hmc_trace_binary_ids(0);
+
+hmc_trace_binary::hmc_trace_binary(const char *filename) :
+  id(++hmc_trace_binary_ids),
+  quit(false)
+{
+  if (filename == nullptr) {
+    std::cerr << "HMC_TRACE_BINARY: ERROR: filename not set!" << std::endl;
+    exit(-1);
+  }
+
+  if (!(this->file = fopen(filename, "wb"))) {
+    std::cerr << "ERROR: couldn't open trace file '" << filename << "'!" << std::endl;
+    exit(-1);
+  }
+
+  struct hmc_trace_binary_header hdr;
+  memcpy(hdr.magic, HMC_TRACE_BINARY_MAGIC, sizeof(hdr.magic));
+  hdr.version = HMC_TRACE_BINARY_VERSION;
+  hdr.record_size = sizeof(struct hmc_trace_binary_record);
+  if (fwrite(&hdr, sizeof(hdr), 1, this->file) != 1) {
+    std::cerr << "ERROR: couldn't write trace file header!" << std::endl;
+    exit(-1);
+  }
+
+  this->writer = std::thread(&hmc_trace_binary::write_out, this);
+}
+
+hmc_trace_binary::~hmc_trace_binary(void)
+{
+  this->quit.store(true, std::memory_order_release);
+  this->kick.notify_one();
+  this->writer.join();
+
+  // the simulation is done, so nobody produces anymore
+  while (this->drain()) ;
+  fclose(this->file);
+
+  for (auto it = this->rings.begin(); it != this->rings.end(); ++it)
+    delete *it;
+}
+
+hmc_trace_binary::ring* hmc_trace_binary::get_ring(void)
+{
+  static thread_local uint64_t cached_id = 0;
+  static thread_local ring *cached = nullptr;
+  if (cached_id != this->id) {
+    std::lock_guard<std::mutex> lock(this->rings_lock);
+    cached = new ring();
+    this->rings.push_back(cached);
+    cached_id = this->id;
+  }
+  return cached;
+}
+
+// writes out everything, which was logged so far, returns false if there was nothing
+bool hmc_trace_binary::drain(void)
+{
+  std::vector<ring*> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(this->rings_lock);
+    snapshot = this->rings;
+  }
+
+  bool written = false;
+  for (auto it = snapshot.begin(); it != snapshot.end(); ++it) {
+    ring *r = *it;
+    uint64_t head = r->head.load(std::memory_order_relaxed);
+    uint64_t tail = r->tail.load(std::memory_order_acquire);
+    while (head != tail) {
+      unsigned first = head & (HMC_TRACE_BINARY_RING_RECORDS - 1);
+      uint64_t cnt = tail - head;
+      if (cnt > HMC_TRACE_BINARY_CHUNK)
+        cnt = HMC_TRACE_BINARY_CHUNK;
+      if (cnt > HMC_TRACE_BINARY_RING_RECORDS - first)
+        cnt = HMC_TRACE_BINARY_RING_RECORDS - first;
+
+      if (fwrite(&r->recs[first], sizeof(struct hmc_trace_binary_record), cnt, this->file) != cnt) {
+        std::cerr << "ERROR: couldn't write to trace file!" << std::endl;
+        exit(-1);
+      }
+      head += cnt;
+      r->head.store(head, std::memory_order_release);
+      written = true;
+    }
+  }
+  return written;
+}
+
+void hmc_trace_binary::write_out(void)
+{
+  while (!this->quit.load(std::memory_order_acquire)) {
+    if (this->drain())
+      continue;
+    std::unique_lock<std::mutex> lock(this->kick_lock);
+    this->kick.wait_for(lock, std::chrono::microseconds(HMC_TRACE_BINARY_FLUSH_US));
+  }
+}
+
+void hmc_trace_binary::execute(enum hmc_link_type linkTypeId, unsigned linkIntTypeId,
+                               uint64_t cycle, uint64_t phyPktAddr,
+                               int fromCubId, int toCubId,
+                               int fromId, int toId,
+                               uint64_t header, uint64_t tail)
+{
+  ring *r = this->get_ring();
+  uint64_t pos = r->tail.load(std::memory_order_relaxed);
+  uint64_t used = pos - r->head.load(std::memory_order_acquire);
+  if (used >= HMC_TRACE_BINARY_RING_RECORDS / 2) {
+    // the writer falls behind, so wake it up, and wait for space if the ring is full
+    this->kick.notify_one();
+    while (pos - r->head.load(std::memory_order_acquire) >= HMC_TRACE_BINARY_RING_RECORDS)
+      std::this_thread::yield();
+  }
+
+  struct hmc_trace_binary_record *rec = &r->recs[pos & (HMC_TRACE_BINARY_RING_RECORDS - 1)];
+  rec->cycle = cycle;
+  rec->phyPktAddr = phyPktAddr;
+  rec->header = header;
+  rec->tail = tail;
+  rec->linkTypeId = (uint8_t)linkTypeId;
+  rec->linkIntTypeId = (uint8_t)linkIntTypeId;
+  rec->fromCubId = (int8_t)fromCubId;
+  rec->toCubId = (int8_t)toCubId;
+  rec->fromId = (int16_t)fromId;
+  rec->toId = (int16_t)toId;
+  r->tail.store(pos + 1, std::memory_order_release);
+}
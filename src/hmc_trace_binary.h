@@ -0,0 +1,82 @@
+#ifndef _HMC_TRACE_BINARY_H_
+#define _HMC_TRACE_BINARY_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "hmc_trace.h"
+
+/*
+ * Compact binary trace: every event is a fixed-size record, which the simulation
+ * thread only copies into its own single producer / single consumer ring. A
+ * background writer drains all rings in chunks and appends them to the file,
+ * tools/hmc_trace2sqlite.py turns the file into the hmcsim_stat table.
+ *
+ * file layout: hmc_trace_binary_header, followed by records (little endian)
+ */
+#define HMC_TRACE_BINARY_MAGIC        "HMCTRACE"
+#define HMC_TRACE_BINARY_VERSION      1
+#define HMC_TRACE_BINARY_RING_RECORDS (1 << 16)   // per thread, power of 2
+#define HMC_TRACE_BINARY_CHUNK        4096        // records per write
+#define HMC_TRACE_BINARY_FLUSH_US     1000        // writer wakeup, if nobody kicks it
+
+struct hmc_trace_binary_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+struct hmc_trace_binary_record {
+  uint64_t cycle;
+  uint64_t phyPktAddr;
+  uint64_t header;
+  uint64_t tail;
+  uint8_t linkTypeId;
+  uint8_t linkIntTypeId;
+  int8_t fromCubId;
+  int8_t toCubId;
+  int16_t fromId;
+  int16_t toId;
+};
+
+static_assert(sizeof(struct hmc_trace_binary_record) == 40, "hmc_trace_binary_record: unexpected padding");
+
+class hmc_trace_binary : public hmc_trace_logger {
+private:
+  struct ring {
+    std::atomic<uint64_t> head;   // next record to write out, owned by the writer
+    std::atomic<uint64_t> tail;   // next free record, owned by the producer
+    struct hmc_trace_binary_record recs[HMC_TRACE_BINARY_RING_RECORDS];
+
+    ring(void) : head(0), tail(0) {}
+  };
+
+  uint64_t id;                   // tells the per thread ring cache apart from an earlier logger
+  FILE *file;
+  std::vector<ring*> rings;
+  std::mutex rings_lock;         // only taken, when a thread logs its first event
+  std::mutex kick_lock;
+  std::condition_variable kick;
+  std::atomic<bool> quit;
+  std::thread writer;
+
+  ring* get_ring(void);
+  bool drain(void);
+  void write_out(void);
+
+public:
+  explicit hmc_trace_binary(const char *filename = "hmcsim_trace.bin");
+  ~hmc_trace_binary(void);
+
+  void execute(enum hmc_link_type linkTypeId, unsigned linkIntTypeId,
+               uint64_t cycle, uint64_t phyPktAddr,
+               int fromCubId, int toCubId,
+               int fromId, int toId,
+               uint64_t header, uint64_t tail);
+};
+
+#endif /* #ifndef _HMC_TRACE_BINARY_H_ */
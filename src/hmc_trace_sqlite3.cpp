@@ -4,9 +4,13 @@
 #include "hmc_trace_sqlite3.h"
 
 // http://www.wassen.net/sqlite-c.html
-hmc_sqlite3::hmc_sqlite3(const char *dbname, bool use_memory) :
+hmc_sqlite3::hmc_sqlite3(const char *dbname, bool use_memory, unsigned batch_size) :
   use_memory(use_memory),
-  dbname(dbname)
+  dbname(dbname),
+  batch_size(batch_size ? batch_size : 1),
+  events(0),
+  start(std::chrono::steady_clock::now()),
+  flush_time(0)
 {
   if (dbname == nullptr) {
     std::cerr << "HMC_SQLITE3: ERROR: dbname not set!" << std::endl;
@@ -29,25 +33,29 @@ hmc_sqlite3::hmc_sqlite3(const char *dbname, bool use_memory) :
       std::cerr << "ERROR: couldn't open database '" << dbname << "'!" << std::endl;
       exit(-1);
     }
+    // a trace is written once: a crash loses it anyway, so don't sync each commit
+    this->exec("PRAGMA journal_mode = WAL;");
+    this->exec("PRAGMA synchronous = OFF;");
   }
 
-  sqlite3_stmt *query;
-  const char *squery = "CREATE TABLE hmcsim_stat (linkTypeId INTEGER, linkIntTypeId INTEGER, cycle INTEGER, physicalPktAddr INTEGER, fromCubId INTEGER, toCubId INTEGER, fromID INTEGER, toId INTEGER, pktHeader INTEGER, pktTail INTEGER);";
-  sqlite3_prepare_v2(this->db, squery, -1, &query, nullptr);
-  if (sqlite3_step(query) != SQLITE_DONE) {
-    std::cerr << "ERROR: create table SQL failed!" << std::endl;
-    exit(-1);
-  }
-  sqlite3_finalize(query);
+  this->exec("CREATE TABLE hmcsim_stat (linkTypeId INTEGER, linkIntTypeId INTEGER, cycle INTEGER, physicalPktAddr INTEGER, fromCubId INTEGER, toCubId INTEGER, fromID INTEGER, toId INTEGER, pktHeader INTEGER, pktTail INTEGER);");
 
   const char *s_sql = "INSERT INTO hmcsim_stat (linkTypeId, linkIntTypeId, cycle, physicalPktAddr, fromCubId, toCubId, fromId, toId, pktHeader, pktTail) values (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10);";
   sqlite3_prepare_v2(this->db, s_sql, -1, &this->sql, nullptr);
+
+  this->batch.reserve(this->batch_size);
 }
 
 hmc_sqlite3::~hmc_sqlite3(void)
 {
+  this->flush();
   sqlite3_finalize(this->sql);
 
+  // extract.py joins on those, building them once is way cheaper than updating them on each insert
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  this->exec("CREATE INDEX hmcsim_stat_addr ON hmcsim_stat (physicalPktAddr);");
+  this->exec("CREATE INDEX hmcsim_stat_cycle ON hmcsim_stat (cycle);");
+
   if (this->use_memory) {
     if (sqlite3_open_v2(this->dbname, &this->filedb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr)) {
       std::cerr << "ERROR: couldn't open database '" << dbname << "'!" << std::endl;
@@ -69,6 +77,53 @@ hmc_sqlite3::~hmc_sqlite3(void)
   }
 
   sqlite3_close(this->db);
+  this->flush_time += std::chrono::steady_clock::now() - t;
+
+  double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+  double flush = std::chrono::duration<double>(this->flush_time).count();
+  std::cout << "HMC_SQLITE3: " << this->events << " events traced in " << total << " s ("
+            << (total > 0.0 ? this->events / total : 0.0) << " events/s), "
+            << flush << " s spent in sqlite3" << std::endl;
+}
+
+void hmc_sqlite3::exec(const char *squery)
+{
+  char *err = nullptr;
+  if (sqlite3_exec(this->db, squery, nullptr, nullptr, &err) != SQLITE_OK) {
+    std::cerr << "ERROR: SQL '" << squery << "' failed: " << (err ? err : "") << std::endl;
+    sqlite3_free(err);
+    exit(-1);
+  }
+}
+
+// inserts all buffered events within one transaction
+void hmc_sqlite3::flush(void)
+{
+  if (this->batch.empty())
+    return;
+
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  this->exec("BEGIN TRANSACTION;");
+  for (auto it = this->batch.begin(); it != this->batch.end(); ++it) {
+    sqlite3_bind_int(this->sql, 1, it->linkTypeId);
+    sqlite3_bind_int(this->sql, 2, it->linkIntTypeId);
+    sqlite3_bind_int64(this->sql, 3, it->cycle);
+    sqlite3_bind_int64(this->sql, 4, it->phyPktAddr);
+    sqlite3_bind_int(this->sql, 5, it->fromCubId);
+    sqlite3_bind_int(this->sql, 6, it->toCubId);
+    sqlite3_bind_int(this->sql, 7, it->fromId);
+    sqlite3_bind_int(this->sql, 8, it->toId);
+    sqlite3_bind_int64(this->sql, 9, it->header);
+    sqlite3_bind_int64(this->sql, 10, it->tail);
+    if (sqlite3_step(this->sql) != SQLITE_DONE) {
+      std::cerr << "ERROR: insert SQL failed!" << std::endl;
+      exit(-1);
+    }
+    sqlite3_reset(this->sql); // clears the binding
+  }
+  this->exec("COMMIT TRANSACTION;");
+  this->batch.clear();
+  this->flush_time += std::chrono::steady_clock::now() - t;
 }
 
 void hmc_sqlite3::execute(enum hmc_link_type linkTypeId, unsigned linkIntTypeId,
@@ -77,19 +132,20 @@ void hmc_sqlite3::execute(enum hmc_link_type linkTypeId, unsigned linkIntTypeId,
                           int fromId, int toId,
                           uint64_t header, uint64_t tail)
 {
-  sqlite3_bind_int(this->sql, 1, (int)linkTypeId);
-  sqlite3_bind_int(this->sql, 2, (int)linkIntTypeId);
-  sqlite3_bind_int64(this->sql, 3, cycle);
-  sqlite3_bind_int64(this->sql, 4, phyPktAddr);
-  sqlite3_bind_int(this->sql, 5, fromCubId);
-  sqlite3_bind_int(this->sql, 6, toCubId);
-  sqlite3_bind_int(this->sql, 7, fromId);
-  sqlite3_bind_int(this->sql, 8, toId);
-  sqlite3_bind_int64(this->sql, 9, header);
-  sqlite3_bind_int64(this->sql, 10, tail);
-  if (sqlite3_step(this->sql) != SQLITE_DONE) {
-    std::cerr << "ERROR: insert SQL failed!" << std::endl;
-    exit(-1);
-  }
-  sqlite3_reset(this->sql); // clears the binding
+  struct event ev;
+  ev.cycle = cycle;
+  ev.phyPktAddr = phyPktAddr;
+  ev.header = header;
+  ev.tail = tail;
+  ev.linkTypeId = (int)linkTypeId;
+  ev.linkIntTypeId = (int)linkIntTypeId;
+  ev.fromCubId = fromCubId;
+  ev.toCubId = toCubId;
+  ev.fromId = fromId;
+  ev.toId = toId;
+  this->batch.push_back(ev);
+  this->events++;
+
+  if (this->batch.size() >= this->batch_size)
+    this->flush();
 }
@@ -1,24 +1,55 @@
 #ifndef _HMC_TRACE_SQLITE3_H_
 #define _HMC_TRACE_SQLITE3_H_
 
+#include <chrono>
 #include <cstdint>
+#include <vector>
 #include <sqlite3.h>
 #include "hmc_trace.h"
 
+/*
+ * Events are buffered and inserted in one transaction per batch, the indexes
+ * are only built when the trace is closed.
+ */
+#define HMC_SQLITE3_BATCH   65536
+
 class hmc_sqlite3 : public hmc_trace_logger {
 private:
+  struct event {
+    uint64_t cycle;
+    uint64_t phyPktAddr;
+    uint64_t header;
+    uint64_t tail;
+    int linkTypeId;
+    int linkIntTypeId;
+    int fromCubId;
+    int toCubId;
+    int fromId;
+    int toId;
+  };
+
   bool use_memory;
   const char *dbname;
   sqlite3 *db;
   sqlite3 *filedb;
   sqlite3_stmt *sql;
 
+  std::vector<struct event> batch;
+  unsigned batch_size;
+  uint64_t events;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::duration flush_time;
+
+  void exec(const char *squery);
+  void flush(void);
+
 public:
   /*
    * Let's first dump everything into memory and then store it afterwards to file!
    * This is highly recommended to not be turned off!!
    */
-  explicit hmc_sqlite3(const char *dbname = "hmcsim_sqlite3.db", bool use_memory = true);
+  explicit hmc_sqlite3(const char *dbname = "hmcsim_sqlite3.db", bool use_memory = true,
+                       unsigned batch_size = HMC_SQLITE3_BATCH);
   ~hmc_sqlite3(void);
 
   void execute(enum hmc_link_type linkTypeId, unsigned linkIntTypeId,
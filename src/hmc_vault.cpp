@@ -6,21 +6,29 @@
 #include "hmc_link_queue.h"
 #include "hmc_macros.h"
 #include "hmc_notify.h"
+#include "hmc_pool.h"
 #include "hmc_vault.h"
 
+#ifdef HMC_USES_COUNTERS
+static_assert(HMC_CTR_VAULT_READS + HMC_CMD_WRITE == HMC_CTR_VAULT_WRITES
+              && HMC_CTR_VAULT_READS + HMC_CMD_LOGIC == HMC_CTR_VAULT_LOGIC, "hmc_vault_counter: not in the order of hmc_cmd_kind");
+#endif /* #ifdef HMC_USES_COUNTERS */
+
 hmc_vault::hmc_vault(unsigned id, hmc_cube *cube, hmc_notify *notify) :
   id(id),
+  link(nullptr),
 #ifdef HMC_USES_NOTIFY
   link_notify(id, notify, this),
   linkrxbuf_notify(id, notify, this),
 #endif /* #ifdef HMC_USES_NOTIFY */
   cube(cube)
+#ifdef HMC_USES_MEM
+  , mem((uint64_t)cube->get_capacity() << 30)
+#endif /* #ifdef HMC_USES_MEM */
+#ifdef HMC_USES_COUNTERS
+  , counters(HMC_CTR_VAULT_NUM)
+#endif /* #ifdef HMC_USES_COUNTERS */
 {
-  for (unsigned i = 0; i < elemsof(this->jtl); i++)
-    this->jtl[i] = nullptr; // is CMC
-
-  for (unsigned i = 0; i < elemsof(this->jtli); i++)
-    this->jtl[this->jtli[i].rsqt] = &this->jtli[i];
 }
 
 hmc_vault::~hmc_vault(void)
@@ -60,16 +68,46 @@ void hmc_vault::clock(void)
 
     if (this->hmcsim_process_rqst(packet)) {
       rx->pop_front();
-      delete[] packet;
+      this->cube->get_pool()->release(packet);
     }
   }
 }
+
+uint64_t hmc_vault::next_event(void)
+{
+  uint64_t next = this->link->next_event();
+  hmc_link_fifo *rx = this->link->get_rx_fifo_out();
+  if (next > 1 && !rx->empty()) {
+    unsigned packetleninbit;
+    char *packet = rx->front(&packetleninbit);
+    hmc_rqst_t cmd = (hmc_rqst_t)HMCSIM_PACKET_REQUEST_GET_CMD(HMC_PACKET_HEADER(packet));
+
+    // a request is only stalled, as long as there is no space for its response
+    unsigned rsp_flits;
+    uint64_t ev = this->hmcsim_packet_resp_len(cmd, &rsp_flits) ? 1 : this->link->get_tx()->space_event();
+    if (ev < next)
+      next = ev;
+  }
+  return next;
+}
+
+void hmc_vault::fast_forward(uint64_t cycles)
+{
+#ifdef HMC_USES_COUNTERS
+  // a pending request waited for response space each skipped cycle (see next_event())
+  if (!this->link->get_rx_fifo_out()->empty())
+    this->counters.inc(HMC_CTR_VAULT_STALLS, cycles);
+#endif /* #ifdef HMC_USES_COUNTERS */
+  this->link->fast_forward(cycles);
+}
 #endif /* #ifndef HMC_USES_BOBSIM */
 
 
 bool hmc_vault::hmcsim_process_rqst(void *packet)
 {
+#ifndef HMC_USES_TIMING_ONLY
   uint64_t rsp_payload[FLIT_WIDTH / 2 * HMC_MAX_FLITS_PER_PACKET];
+#endif /* #ifndef HMC_USES_TIMING_ONLY */
   uint32_t error = 0x00;
 
   /*
@@ -103,6 +141,9 @@ bool hmc_vault::hmcsim_process_rqst(void *packet)
   assert(tx);
   if (!no_response && !tx->has_space(packetleninbit)) {
 //    HMCSIM_TRACE_STALL(dev->hmc, dev->id, 1);
+#ifdef HMC_USES_COUNTERS
+    this->counters.inc(HMC_CTR_VAULT_STALLS);
+#endif /* #ifdef HMC_USES_COUNTERS */
     return false;
   }
 
@@ -110,56 +151,21 @@ bool hmc_vault::hmcsim_process_rqst(void *packet)
    * Step 4: perform the op
    *
    */
-  hmc_response_t rsp_cmd;
-  if (jtl[cmd] != nullptr) {
-    rsp_cmd = jtl[cmd]->rsp_cmd;
-
+  const struct hmc_cmd_desc *desc = hmc_cmd_get(cmd);
+  hmc_response_t rsp_cmd = desc->rsp_cmd;
+  bool af = false;
+  if (desc->rqst_flits) {
     // ToDo: if BOBSIM -> do it before issuing into bobsim! -> alignment!
-    switch (cmd) {
-    case WR48:
-    case P_WR48:
-    case RD48:
-      error = (this->cube->hmcsim_util_get_bsize() < 48);
-      break;
-
-    case WR64:
-    case P_WR64:
-    case RD64:
-      error = (this->cube->hmcsim_util_get_bsize() < 64);
-      break;
-
-    case WR80:
-    case P_WR80:
-    case RD80:
-      error = (this->cube->hmcsim_util_get_bsize() < 80);
-      break;
-
-    case WR96:
-    case P_WR96:
-    case RD96:
-      error = (this->cube->hmcsim_util_get_bsize() < 96);
-      break;
-
-    case WR112:
-    case P_WR112:
-    case RD112:
-      error = (this->cube->hmcsim_util_get_bsize() < 112);
-      break;
-
-    case WR128:
-    case P_WR128:
-    case RD128:
-      error = (this->cube->hmcsim_util_get_bsize() < 128);
-      break;
-
-    case WR256:
-    case P_WR256:
-    case RD256:
-      error = (this->cube->hmcsim_util_get_bsize() < 256);
-      break;
-    default:
-      break;
+    if (desc->min_bsize)
+      error = (this->cube->hmcsim_util_get_bsize() < desc->min_bsize);
+#ifdef HMC_USES_MEM
+    if (!error) {
+      unsigned flits = HMCSIM_PACKET_REQUEST_GET_LNG(header);
+      this->mem.process(cmd, HMCSIM_PACKET_REQUEST_GET_ADRS(header),
+                        &((uint64_t*)packet)[1], ((flits - (flits > 0)) * FLIT_WIDTH) / 8,
+                        rsp_payload, ((rsp_flits - (rsp_flits > 0)) * FLIT_WIDTH) / 8, &af);
     }
+#endif /* #ifdef HMC_USES_MEM */
   }
   else {
 #if 0
@@ -197,10 +203,15 @@ bool hmc_vault::hmcsim_process_rqst(void *packet)
       break;
     }
 #endif
-    rsp_cmd = RSP_ERROR;
   }
 
 //  HMCSIM_TRACE_RQST(dev->hmc, dev->id, quad, vault, bank, addr, length, cmd_s);
+#ifdef HMC_USES_COUNTERS
+  this->counters.inc(HMC_CTR_VAULT_RQSTS);
+  this->counters.inc(HMC_CTR_VAULT_READS + desc->kind);
+  if (error || !desc->rqst_flits)
+    this->counters.inc(HMC_CTR_VAULT_ERRORS);
+#endif /* #ifdef HMC_USES_COUNTERS */
 
   /*
    * Step 4: build and register the response with vault response queue
@@ -226,18 +237,29 @@ bool hmc_vault::hmcsim_process_rqst(void *packet)
     unsigned rsp_frp = HMCSIM_PACKET_REQUEST_GET_FRP(tail);
     unsigned rsp_rrp = HMCSIM_PACKET_REQUEST_GET_RRP(tail);
 
-    char *response_packet = new char[rsp_flits * FLIT_WIDTH / 8];
+    char *response_packet = this->cube->get_pool()->alloc(HMC_PACKET_STORED_FLITS(rsp_flits));
+#ifndef HMC_USES_TIMING_ONLY
     if (rsp_flits > 1)
-      memcpy(&response_packet[1], rsp_payload, ((rsp_flits - 1) * FLIT_WIDTH) / 8);
+      memcpy(&((uint64_t*)response_packet)[1], rsp_payload, ((rsp_flits - 1) * FLIT_WIDTH) / 8);
+#endif /* #ifndef HMC_USES_TIMING_ONLY */
     uint64_t *r_head = ((uint64_t*)response_packet);
-    uint64_t *r_tail = &((uint64_t*)response_packet)[(rsp_flits << 1) - 1];
+    uint64_t *r_tail = &((uint64_t*)response_packet)[HMC_PACKET_TAIL_IDX(rsp_flits)];
+
+    /* -- routing fields, the response returns to the cube and quad of its slid */
+    const struct hmc_packet_meta *rqst_meta = hmc_pool::meta((char*)packet);
+    struct hmc_packet_meta *r_meta = hmc_pool::meta(response_packet);
+    *r_meta = *rqst_meta;
+    r_meta->hops = 0;
+    r_meta->exit_cub = (uint8_t)~0x0;
+    r_meta->cub = this->cube->slid_to_cubid(rsp_slid);
+    r_meta->quad = this->cube->slid_to_quadid(rsp_slid);
 
     /* -- packet head */
     *r_head = 0x0ull;
     *r_head |= HMCSIM_PACKET_RESPONSE_SET_CMD(rsp_cmd);
     *r_head |= HMCSIM_PACKET_RESPONSE_SET_LNG(rsp_flits);
     *r_head |= HMCSIM_PACKET_RESPONSE_SET_TAG(rsp_tag);
-    *r_head |= HMCSIM_PACKET_RESPONSE_SET_AF(0);
+    *r_head |= HMCSIM_PACKET_RESPONSE_SET_AF(af);
 //#ifdef HMC_HAS_LOGIC
 //    if (HMCSIM_PACKET_REQUEST_GET_FROM_LOGIC(tail)) {
 //      *r_head |= HMCSIM_PACKET_RESPONSE_SET_TO_LOGIC();
@@ -263,7 +285,7 @@ bool hmc_vault::hmcsim_process_rqst(void *packet)
     if (error)
       *r_tail |= HMCSIM_PACKET_RESPONSE_SET_ERRSTAT(0x1);    // ToDo: FixME with specific code
     *r_tail |= HMCSIM_PACKET_RESPONSE_SET_RTC(rsp_rtc);
-    *r_tail |= HMCSIM_PACKET_RESPONSE_SET_CRC(hmcsim_crc32(response_packet, rsp_flits));
+    *r_tail |= HMCSIM_PACKET_RESPONSE_SET_CRC(hmcsim_crc32(response_packet, HMC_PACKET_STORED_FLITS(rsp_flits)));
 
     /* -- register the response */
     tx->push_back(response_packet, packetleninbit);
@@ -271,3 +293,12 @@ bool hmc_vault::hmcsim_process_rqst(void *packet)
 
   return true;
 }
+
+#ifdef HMC_USES_COUNTERS
+void hmc_vault::collect_counters(hmc_counters *ctrs, const std::string &prefix)
+{
+  ctrs->add(prefix, &this->counters, hmc_vault_counter_names);
+  if (this->link != nullptr)
+    this->link->collect_counters(ctrs, prefix + ".link");
+}
+#endif /* #ifdef HMC_USES_COUNTERS */
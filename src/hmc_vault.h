@@ -9,21 +9,22 @@
 #ifdef HMC_USES_BOBSIM
 # include <cassert>
 #endif /* #ifdef HMC_USES_BOBSIM */
+#include "hmc_cmd.h"
 #include "hmc_macros.h"
 #include "hmc_notify.h"
 #include "hmc_sim_t.h"
 #include "hmc_link.h"
 #include "hmc_module.h"
+#ifdef HMC_USES_MEM
+# include "hmc_mem.h"
+#endif /* #ifdef HMC_USES_MEM */
+#ifdef HMC_USES_COUNTERS
+# include <string>
+# include "hmc_counters.h"
+#endif /* #ifdef HMC_USES_COUNTERS */
 
 class hmc_cube;
 
-struct jtl_t {
-  hmc_rqst_t rsqt;
-  unsigned rsp_len;
-  hmc_response_t rsp_cmd;
-  bool rsp;
-};
-
 class hmc_vault : public hmc_module, private hmc_notify_cl {
 private:
   unsigned id;
@@ -33,6 +34,12 @@ private:
   hmc_notify linkrxbuf_notify;
 #endif /* #ifdef HMC_USES_NOTIFY */
   hmc_cube *cube;
+#ifdef HMC_USES_MEM
+  hmc_mem mem;
+#endif /* #ifdef HMC_USES_MEM */
+#ifdef HMC_USES_COUNTERS
+  hmc_counter_block counters;
+#endif /* #ifdef HMC_USES_COUNTERS */
 
   ALWAYS_INLINE uint32_t hmcsim_crc32(void *packet, unsigned flits)
   {
@@ -49,68 +56,6 @@ private:
 #endif /* #if defined(NDEBUG) && defined(HMC_USES_CRC) */
   }
 
-  struct jtl_t* jtl[ 0xFF ];
-  struct jtl_t jtli[58] = {
-    { WR16, 1, WR_RS, true },
-    { WR32, 1, WR_RS, true },
-    { WR48, 1, WR_RS, true },
-    { WR64, 1, WR_RS, true },
-    { WR80, 1, WR_RS, true },
-    { WR96, 1, WR_RS, true },
-    { WR112, 1, WR_RS, true },
-    { WR128, 1, WR_RS, true },
-    { WR256, 1, WR_RS, true },
-    { MD_WR, 1, MD_WR_RS, true },
-    { BWR, 1, WR_RS, true },
-    { TWOADD8, 0, WR_RS, true },
-    { ADD16, 0, WR_RS, true },
-    { P_WR16, 0, RSP_ERROR, false },
-    { P_WR32, 0, RSP_ERROR, false },
-    { P_WR48, 0, RSP_ERROR, false },
-    { P_WR64, 0, RSP_ERROR, false },
-    { P_WR80, 0, RSP_ERROR, false },
-    { P_WR96, 0, RSP_ERROR, false },
-    { P_WR112, 0, RSP_ERROR, false },
-    { P_WR128, 0, RSP_ERROR, false },
-    { P_WR256, 0, RSP_ERROR, false },
-    { P_BWR, 0, RSP_ERROR, false },
-    { P_2ADD8, 0, RSP_ERROR, false },
-    { P_ADD16, 0, RSP_ERROR, false },
-    { RD16, 2, RD_RS, true },
-    { RD32, 3, RD_RS, true },
-    { RD48, 4, RD_RS, true },
-    { RD64, 5, RD_RS, true },
-    { RD80, 6, RD_RS, true },
-    { RD96, 7, RD_RS, true },
-    { RD112, 8, RD_RS, true },
-    { RD128, 9, RD_RS, true },
-    { RD256, 17, RD_RS, true },
-    { MD_RD, 2, MD_RD_RS, true },
-    { FLOW_NULL, 0, RSP_ERROR, false },
-    { PRET, 0, RSP_ERROR, false },
-    { TRET, 0, RSP_ERROR, false },
-    { IRTRY, 0, RSP_ERROR, false },
-    { TWOADDS8R, 2, RD_RS, true },
-    { ADDS16R, 2, RD_RS, true },
-    { INC8, 1, WR_RS, true },
-    { P_INC8, 0, RSP_ERROR, false },
-    { XOR16, 2, RD_RS, false },
-    { OR16, 2, RD_RS, false },
-    { NOR16, 2, RD_RS, false },
-    { AND16, 2, RD_RS, false },
-    { NAND16, 2, RD_RS, false },
-    { CASGT8, 2, RD_RS, false },
-    { CASGT16, 2, RD_RS, false },
-    { CASLT8, 2, RD_RS, false },
-    { CASLT16, 2, RD_RS, false },
-    { CASEQ8, 2, RD_RS, false },
-    { CASZERO16, 2, RD_RS, false },
-    { EQ8, 1, WR_RS, true },
-    { EQ16, 1, WR_RS, true },
-    { BWR8R, 2, RD_RS, true },
-    { SWAP16, 2, RD_RS, true }
-  };
-
   bool notify_up(unsigned id) {
 #ifdef HMC_USES_NOTIFY
     return (!this->link_notify.get_notification()
@@ -127,8 +72,16 @@ public:
   void clock(void) {}
 #else
   void clock(void);
+  uint64_t next_event(void);
+  void fast_forward(uint64_t cycles);
 #endif /* #ifdef HMC_USES_BOBSIM */
   unsigned get_id(void) { return this->id; }
+#if defined(HMC_USES_THREADS) && defined(HMC_USES_NOTIFY)
+  ALWAYS_INLINE bool get_notification(void)
+  {
+    return this->link_notify.get_notification() || this->linkrxbuf_notify.get_notification();
+  }
+#endif /* #if defined(HMC_USES_THREADS) && defined(HMC_USES_NOTIFY) */
   bool set_link(unsigned linkId, hmc_link* link, enum hmc_link_type linkType) {
     this->link = link;
 #ifdef HMC_USES_NOTIFY
@@ -137,43 +90,21 @@ public:
     return true;
   }
   bool hmcsim_process_rqst(void *packet);
+#ifdef HMC_USES_COUNTERS
+  void collect_counters(hmc_counters *ctrs, const std::string &prefix);
+#endif /* #ifdef HMC_USES_COUNTERS */
   ALWAYS_INLINE bool hmcsim_packet_resp_len(hmc_rqst_t cmd, unsigned *rsp_len)
   {
-    if (jtl[cmd] != nullptr) {
-      *rsp_len = jtl[cmd]->rsp_len;
-      return !jtl[cmd]->rsp;
-    }
-    else {
-#if 0
-      switch (cmd) {
-      /* begin CMC commands */
-      default:
-#if 0
-        switch (dev->hmc->cmcs[ cmd ]->rsp_cmd) {
-        case MD_RD_RS:
-        case MD_WR_RS:
-        case RSP_NONE:
-          /* no response packet */
-          response = false;
-          break;
-        default:
-          break;
-        }
-#endif
-        break;
-      }
-#endif
-      *rsp_len = 2;
-      return false;
-    }
+    const struct hmc_cmd_desc *desc = hmc_cmd_get(cmd);
+    *rsp_len = desc->rsp_flits;
+    return !desc->rsp;
   }
 #ifdef HMC_USES_BOBSIM
 #ifdef HMC_USES_NOTIFY
   bool pkt_has_response(hmc_rqst_t cmd)
   {
-    struct jtl_t* cmd_type = this->jtl[cmd];
-    assert(cmd_type != nullptr);
-    return cmd_type->rsp;
+    assert(hmc_cmd_get(cmd)->rqst_flits);
+    return hmc_cmd_get(cmd)->rsp;
   }
 #endif /* #ifdef HMC_USES_NOTIFY */
 #endif /* #ifdef HMC_USES_BOBSIM */
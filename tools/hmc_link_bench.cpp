@@ -0,0 +1,249 @@
+/*
+ * Microbenchmark: per-cycle cost of a single link (tx queue -> rx fifo).
+ *
+ * The same traffic is run through
+ *  - a replica of the former std::list based hmc_link_queue / hmc_link_fifo and
+ *  - the ring buffer based hmc_link of libhmcsim,
+ * both must deliver the same packets within the same amount of cycles.
+ *
+ * make bench
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <tuple>
+#include <utility>
+#include "../src/config.h"
+#include "../src/hmc_link.h"
+#include "../src/hmc_link_fifo.h"
+#include "../src/hmc_link_queue.h"
+#include "../src/hmc_pool.h"
+#include "../src/hmc_sim.h"
+#include "../src/hmc_slid.h"
+
+#define BENCH_CYCLES      2000000
+#define BENCH_BITWIDTH    HMCSIM_FULL_LINK_WIDTH
+#define BENCH_BITRATE     HMCSIM_BR30
+
+static const unsigned bench_flits[] = { 1, 2, 5, 9, 17, 3 };
+
+class legacy_fifo {
+private:
+  unsigned bitoccupation;
+  unsigned bitoccupationmax;
+  std::list< std::pair<char*, unsigned> > buf;
+
+public:
+  explicit legacy_fifo(unsigned bitsize) :
+    bitoccupation(0),
+    bitoccupationmax(bitsize * 1000)
+  {}
+
+  bool reserve_space(unsigned packetleninbit)
+  {
+    if ((this->bitoccupation + packetleninbit) <= this->bitoccupationmax) {
+      this->bitoccupation += packetleninbit;
+      return true;
+    }
+    return false;
+  }
+  void push_back_set_avail(char *packet, unsigned packetleninbit)
+  {
+    this->buf.push_back(std::make_pair(packet, packetleninbit));
+  }
+  bool empty(void)
+  {
+    return this->buf.empty();
+  }
+  char* front(void)
+  {
+    return this->buf.front().first;
+  }
+  void pop_front(void)
+  {
+    this->bitoccupation -= this->buf.front().second;
+    this->buf.pop_front();
+  }
+};
+
+class legacy_queue {
+private:
+  uint64_t *cur_cycle;
+  unsigned bitoccupation;
+  unsigned bitoccupationmax;
+  unsigned bitwidth;
+  unsigned bitrate;
+  std::list< std::tuple<char*, unsigned, unsigned, uint64_t> > list;
+  legacy_fifo *buf;
+
+public:
+  legacy_queue(uint64_t *cur_cycle, legacy_fifo *buf, unsigned link_bitwidth, float link_bitrate) :
+    cur_cycle(cur_cycle),
+    bitoccupation(0),
+    buf(buf)
+  {
+    float bitrate = link_bitrate / (1.0f / (float)HMC_CLK_PERIOD_NS);
+    this->bitwidth = link_bitwidth;
+    this->bitoccupationmax = bitrate * link_bitwidth * 1000;
+    this->bitrate = bitrate * 1000.0;
+  }
+
+  bool has_space(void)
+  {
+    return (this->bitoccupation < this->bitoccupationmax);
+  }
+  void push_back(char *packet, unsigned packetleninbit)
+  {
+    packetleninbit *= 1000;
+    unsigned UI = packetleninbit / this->bitwidth;
+    this->bitoccupation += UI;
+    this->list.push_back(std::make_tuple(packet, UI, packetleninbit, *this->cur_cycle));
+  }
+  void clock(void)
+  {
+    if (this->bitoccupation) {
+      uint64_t ccycle = *this->cur_cycle;
+      unsigned tbitrate = this->bitrate;
+      auto it = this->list.begin();
+      do {
+        unsigned UI = std::get<1>(*it);
+        if (std::get<3>(*it) == ccycle)
+          break;
+
+        if (UI >= tbitrate) {
+          if (this->buf->reserve_space(tbitrate * this->bitwidth)) {
+            std::get<1>(*it) -= tbitrate;
+            this->bitoccupation -= tbitrate;
+          }
+          break;
+        }
+        else if (UI) {
+          if (this->buf->reserve_space(UI * this->bitwidth)) {
+            std::get<1>(*it) = 0;
+            this->bitoccupation -= UI;
+            tbitrate -= UI;
+          }
+          else
+            break;
+        }
+        ++it;
+      } while (it != this->list.end());
+    }
+
+    if (this->list.empty())
+      return;
+
+    auto front = this->list.front();
+    if (!std::get<1>(front)) {
+      this->buf->push_back_set_avail(std::get<0>(front), std::get<2>(front));
+      this->list.pop_front();
+    }
+  }
+};
+
+struct bench_result {
+  double ns_per_cycle;
+  uint64_t delivered;
+  uint64_t checksum;
+};
+
+// every cycle: fill the tx side as long as there is space, clock the link and drain the rx fifo
+template <typename PUSH, typename CLOCK, typename DRAIN>
+static void bench_run(uint64_t *clk, hmc_pool *pool, PUSH push, CLOCK clock, DRAIN drain,
+                      struct bench_result *res)
+{
+  unsigned sel = 0;
+  res->delivered = 0;
+  res->checksum = 0;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (*clk = 0; *clk < BENCH_CYCLES; (*clk)++) {
+    unsigned flits = bench_flits[sel];
+    char *packet = pool->alloc(flits);
+    *(uint64_t*)packet = *clk;
+    if (push(packet, flits * FLIT_WIDTH))
+      sel = (sel + 1) % elemsof(bench_flits);
+    else
+      pool->release(packet);
+
+    clock();
+
+    char *out;
+    while ((out = drain()) != nullptr) {
+      res->delivered++;
+      res->checksum += *(uint64_t*)out ^ (*clk << 20);
+      pool->release(out);
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  res->ns_per_cycle = std::chrono::duration<double, std::nano>(end - start).count() / BENCH_CYCLES;
+}
+
+int main(int argc, char* argv[])
+{
+  uint64_t clk = 0;
+  hmc_pool pool;
+  struct bench_result legacy_res, ring_res;
+
+  {
+    legacy_fifo fifo(FLIT_WIDTH * RETRY_BUFFER_FLITS);
+    legacy_queue queue(&clk, &fifo, BENCH_BITWIDTH, BENCH_BITRATE);
+    bench_run(&clk, &pool,
+              [&](char *packet, unsigned len) {
+                if (!queue.has_space())
+                  return false;
+                queue.push_back(packet, len);
+                return true;
+              },
+              [&](void) { queue.clock(); },
+              [&](void) -> char* {
+                if (fifo.empty())
+                  return nullptr;
+                char *packet = fifo.front();
+                fifo.pop_front();
+                return packet;
+              },
+              &legacy_res);
+  }
+
+  {
+    hmc_slid slid0(0), slid1(1);
+    hmc_link link0(&clk, HMC_LINK_SLID, &slid0);
+    hmc_link link1(&clk, HMC_LINK_SLID, &slid1);
+    link0.connect_linkports(&link1);
+    link1.set_ilink_notify(0, 0, nullptr, nullptr);
+    link0.adjust_both_linkends(BENCH_BITWIDTH, BENCH_BITRATE, FLIT_WIDTH * RETRY_BUFFER_FLITS);
+
+    hmc_link_queue *tx = link0.get_tx();
+    hmc_link_fifo *rx = link1.get_rx_fifo_out();
+    bench_run(&clk, &pool,
+              [&](char *packet, unsigned len) {
+                return tx->has_space(len) && tx->push_back(packet, len);
+              },
+              [&](void) { link1.clock(); },
+              [&](void) -> char* {
+                if (rx->empty())
+                  return nullptr;
+                unsigned len;
+                char *packet = rx->front(&len);
+                rx->pop_front();
+                return packet;
+              },
+              &ring_res);
+  }
+
+  std::cout << "link bench, " << BENCH_CYCLES << " cycles" << std::endl;
+  std::cout << "  std::list:   " << legacy_res.ns_per_cycle << " ns/cycle, "
+            << legacy_res.delivered << " packets" << std::endl;
+  std::cout << "  ring buffer: " << ring_res.ns_per_cycle << " ns/cycle, "
+            << ring_res.delivered << " packets" << std::endl;
+  std::cout << "  speedup:     " << legacy_res.ns_per_cycle / ring_res.ns_per_cycle << "x" << std::endl;
+
+  if (legacy_res.delivered != ring_res.delivered || legacy_res.checksum != ring_res.checksum) {
+    std::cerr << "ERROR: ring buffer link diverges from std::list link!" << std::endl;
+    return -1;
+  }
+  return 0;
+}
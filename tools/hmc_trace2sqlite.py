@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+# converts a HMC_LOGGING_BINARY trace into the hmcsim_stat table, as written by
+# HMC_LOGGING_SQLITE3, therewith extract.py works on both
+#
+# usage: hmc_trace2sqlite.py [trace file (hmcsim_trace.bin)] [db file (hmcsim.db)]
+import os
+import sqlite3
+import struct
+import sys
+
+MAGIC = b"HMCTRACE"
+VERSION = 1
+# see struct hmc_trace_binary_header / hmc_trace_binary_record (src/hmc_trace_binary.h)
+HEADER = struct.Struct("<8sII")
+RECORD = struct.Struct("<QQQQBBbbhh")
+BATCH = 65536
+
+def to_int64(v):
+    # sqlite3 INTEGER is signed, the HMC_LOGGING_SQLITE3 backend binds the same bits
+    return v - (1 << 64) if v >= (1 << 63) else v
+
+def records(f, size):
+    while True:
+        buf = f.read(size * BATCH)
+        if not buf:
+            return
+        if len(buf) % size:
+            sys.stderr.write("WARNING: truncated trace, dropping the last record\n")
+            buf = buf[:len(buf) - len(buf) % size]
+        for off in range(0, len(buf), size):
+            cycle, addr, header, tail, linkType, linkIntType, fromCub, toCub, fromId, toId = \
+                RECORD.unpack_from(buf, off)
+            yield (linkType, linkIntType, to_int64(cycle), to_int64(addr), fromCub, toCub,
+                   fromId, toId, to_int64(header), to_int64(tail))
+
+def main():
+    trace = sys.argv[1] if len(sys.argv) > 1 else "hmcsim_trace.bin"
+    dbname = sys.argv[2] if len(sys.argv) > 2 else "hmcsim.db"
+
+    f = open(trace, "rb")
+    magic, version, size = HEADER.unpack(f.read(HEADER.size))
+    if magic != MAGIC or version != VERSION or size < RECORD.size:
+        sys.stderr.write("ERROR: '%s' is no hmcsim binary trace (version %d)!\n" % (trace, VERSION))
+        sys.exit(-1)
+
+    if os.path.exists(dbname):
+        os.remove(dbname)
+    conn = sqlite3.connect(dbname)
+    c = conn.cursor()
+    c.execute("PRAGMA journal_mode = OFF")
+    c.execute("PRAGMA synchronous = OFF")
+    c.execute("CREATE TABLE hmcsim_stat (linkTypeId INTEGER, linkIntTypeId INTEGER, cycle INTEGER, "
+              "physicalPktAddr INTEGER, fromCubId INTEGER, toCubId INTEGER, fromID INTEGER, toId INTEGER, "
+              "pktHeader INTEGER, pktTail INTEGER);")
+
+    batch = []
+    ctr = 0
+    for rec in records(f, size):
+        batch.append(rec)
+        if len(batch) == BATCH:
+            c.executemany("INSERT INTO hmcsim_stat VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", batch)
+            ctr += len(batch)
+            batch = []
+    if batch:
+        c.executemany("INSERT INTO hmcsim_stat VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", batch)
+        ctr += len(batch)
+    conn.commit()
+    conn.close()
+    f.close()
+    print("%d records written to %s" % (ctr, dbname))
+
+if __name__ == "__main__":
+    main()